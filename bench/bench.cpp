@@ -0,0 +1,252 @@
+#include "generator.hpp"
+#include <bmsparser.hpp>
+#include <bmsparser/convert.hpp>
+#include <bmsparser/analysis.hpp>
+#include <bmsparser/memory.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <cstdio>
+
+/// Result of one benchmark
+struct result_t
+{
+    /// Fastest iteration, in seconds
+    double seconds;
+
+    /// Allocations in one iteration
+    size_t allocations;
+
+    /// Highest bytes live during one iteration, above those live before it
+    size_t peak;
+};
+
+static result_t run(const std::function<void()> &body);
+static void report(const std::string &name, const result_t &result, size_t bytes, size_t items, const char *unit);
+static bool selected(const std::string &name);
+static std::string write_chart(const std::string &name, const std::string &text);
+
+static std::string filter;
+
+// Results of query loops are stored here, so the loops are not optimized away.
+static volatile float sink;
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+    {
+        filter = argv[1];
+    }
+
+    std::printf("%-28s %10s %10s %14s %12s %10s\n", "benchmark", "ms/iter", "MB/s", "items/s", "allocs/iter", "peak KB");
+
+    std::vector<std::pair<std::string, bench::ChartConfig>> charts;
+    charts.emplace_back("default", bench::ChartConfig());
+    {
+        bench::ChartConfig config;
+        config.measures = 999;
+        config.resolution = 32;
+        config.channels = 16;
+        charts.emplace_back("dense", config);
+    }
+    {
+        bench::ChartConfig config;
+        config.measures = 400;
+        config.bpmChanges = 1;
+        config.stops = 0.5f;
+        config.signatures = 0.5f;
+        charts.emplace_back("speed", config);
+    }
+    {
+        bench::ChartConfig config;
+        config.longNotes = 1;
+        config.randoms = 50;
+        charts.emplace_back("ln_random", config);
+    }
+
+    for (const std::pair<std::string, bench::ChartConfig> &chart : charts)
+    {
+        std::string name = "parseBMS/" + chart.first;
+        if (!selected(name) && !selected("pos2time/" + chart.first) && !selected("frac2pos/" + chart.first) && !selected("density/" + chart.first))
+        {
+            continue;
+        }
+        std::string text = bench::generateChart(chart.second);
+        std::string file = write_chart(chart.first, text);
+        bms::Chart *parsed = bms::parseBMS(file);
+        size_t objs = parsed->objs.size();
+
+        if (selected(name))
+        {
+            result_t result = run([&]()
+                                  { delete bms::parseBMS(file); });
+            report(name, result, text.length(), objs, "objs");
+
+            // Where the time goes: the sort step is the one merge_runs replaced std::stable_sort in.
+            bms::ParseStats stats;
+            delete bms::parseBMS(file, std::vector<int>(), &stats);
+            std::printf("  read %.2f  tokenize %.2f  decode %.2f  sort %.2f  sectors %.2f  timing %.2f ms\n",
+                        stats.readNs / 1e6, stats.tokenizeNs / 1e6, stats.decodeNs / 1e6, stats.sortNs / 1e6, stats.sectorsNs / 1e6, stats.timingNs / 1e6);
+            bms::MemoryUsage usage = parsed->memoryUsage();
+            std::printf("  chart %zu KB: objs %zu  wavs %zu  bmps %zu  bar lines %zu  sectors %zu  bgas %zu  measures %zu  other %zu KB\n",
+                        usage.total() / 1024, usage.objs / 1024, usage.wavs / 1024, usage.bmps / 1024, usage.barLines / 1024, usage.sectors / 1024, usage.bgas / 1024, usage.measures / 1024,
+                        (usage.chart + usage.strings + usage.randoms) / 1024);
+        }
+
+        if (selected("pos2time/" + chart.first))
+        {
+            const size_t queries = 1000000;
+            float length = parsed->stats.length, end = parsed->measureStarts.back();
+            float sum = 0;
+            result_t result = run([&]()
+                                  {
+                                      for (size_t i = 0; i < queries; i++)
+                                      {
+                                          sum += parsed->pos2time(end * i / queries);
+                                          sum += parsed->time2pos(length * i / queries);
+                                      } });
+            report("pos2time/" + chart.first, result, 0, queries * 2, "queries");
+            sink = sum;
+        }
+
+        if (selected("frac2pos/" + chart.first))
+        {
+            const size_t queries = 1000000;
+            float measures = (float)parsed->measures;
+            float sum = 0;
+            result_t result = run([&]()
+                                  {
+                                      for (size_t i = 0; i < queries; i++)
+                                      {
+                                          sum += parsed->pos2frac(parsed->frac2pos(measures * i / queries));
+                                      } });
+            report("frac2pos/" + chart.first, result, 0, queries * 2, "queries");
+            sink = sum;
+        }
+
+        if (selected("density/" + chart.first))
+        {
+            result_t result = run([&]()
+                                  { bms::analyzeDensity(*parsed, 1.0f, 256); });
+            report("density/" + chart.first, result, 0, objs, "objs");
+        }
+
+        delete parsed;
+        std::filesystem::remove(file);
+    }
+
+    if (selected("parseBMS/shuffled"))
+    {
+        // Channel lines in random order defeat the presorted runs the merge relies on.
+        std::string text = bench::generateChart(charts[1].second);
+        std::vector<std::string> lines;
+        size_t begin = 0;
+        for (size_t end; (end = text.find('\n', begin)) != std::string::npos; begin = end + 1)
+        {
+            lines.push_back(text.substr(begin, end - begin + 1));
+        }
+        std::mt19937 engine(1);
+        for (size_t i = lines.size() - 1; i > 0; i--)
+        {
+            std::swap(lines[i], lines[engine() % (i + 1)]);
+        }
+        text.clear();
+        for (const std::string &line : lines)
+        {
+            text += line;
+        }
+        std::string file = write_chart("shuffled", text);
+        bms::Chart *parsed = bms::parseBMS(file);
+        size_t objs = parsed->objs.size();
+        delete parsed;
+        report("parseBMS/shuffled", run([&]()
+                                        { delete bms::parseBMS(file); }),
+               text.length(), objs, "objs");
+        std::filesystem::remove(file);
+    }
+
+    if (selected("parseBMS/floats"))
+    {
+        // Headers and signatures only, which exercises the locale-free float reader.
+        std::string text;
+        char line[64];
+        for (int i = 0; i < 20000; i++)
+        {
+            std::snprintf(line, sizeof(line), "#BPM%c%c %.3f\n#%03d02:%.4f\n", '1' + i / 36 % 9, "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"[i % 36], 60 + i * 0.173, i % 1000, 0.25 + i % 16 * 0.0625);
+            text += line;
+        }
+        std::string file = write_chart("floats", text);
+        report("parseBMS/floats", run([&]()
+                                      { delete bms::parseBMS(file); }),
+               text.length(), 40000, "lines");
+        std::filesystem::remove(file);
+    }
+
+    if (selected("sjis_to_utf8"))
+    {
+        std::string input = bench::generateShiftJIS(1 << 20, 1);
+        std::string output;
+        result_t result = run([&]()
+                              {
+                                  output.clear();
+                                  bms::sjis_to_utf8(input, output); });
+        report("sjis_to_utf8", result, input.length(), input.length(), "bytes");
+    }
+
+    return 0;
+}
+
+/**
+ * Run a benchmark until it has taken half a second, at least three times.
+ * Allocations and peak memory are counted on the first, warm-up run.
+ */
+static result_t run(const std::function<void()> &body)
+{
+    result_t result;
+    bms::AllocationStats before = bms::allocationStats();
+    bms::resetAllocationPeak();
+    body();
+    bms::AllocationStats after = bms::allocationStats();
+    result.allocations = after.count - before.count;
+    result.peak = after.peak - before.live;
+
+    result.seconds = 1e30;
+    double total = 0;
+    for (int i = 0; i < 3 || total < 0.5; i++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        body();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.seconds = std::min(result.seconds, seconds);
+        total += seconds;
+    }
+    return result;
+}
+
+static void report(const std::string &name, const result_t &result, size_t bytes, size_t items, const char *unit)
+{
+    char rate[32] = "-";
+    if (bytes)
+    {
+        std::snprintf(rate, sizeof(rate), "%.1f", bytes / result.seconds / 1e6);
+    }
+    char count[32];
+    std::snprintf(count, sizeof(count), "%.2fM %s", items / result.seconds / 1e6, unit);
+    std::printf("%-28s %10.3f %10s %14s %12zu %10zu\n", name.c_str(), result.seconds * 1e3, rate, count, result.allocations, result.peak / 1024);
+}
+
+static bool selected(const std::string &name)
+{
+    return name.find(filter) != std::string::npos;
+}
+
+static std::string write_chart(const std::string &name, const std::string &text)
+{
+    std::string file = (std::filesystem::temp_directory_path() / ("bmsparser_bench_" + name + ".bms")).string();
+    std::ofstream output(file, std::ios::binary);
+    output << text;
+    return file;
+}
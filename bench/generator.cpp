@@ -0,0 +1,153 @@
+#include "generator.hpp"
+#include <bmsparser/convert.hpp>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <cstdio>
+
+using namespace bench;
+
+namespace
+{
+    /// Draws from std::mt19937 directly, since the standard distributions differ between libraries.
+    class Random
+    {
+    public:
+        Random(unsigned int seed) : engine(seed) {}
+
+        int below(int n)
+        {
+            return (int)(this->engine() % (unsigned int)n);
+        }
+
+        bool chance(float p)
+        {
+            return this->engine() < p * 4294967296.0;
+        }
+
+    private:
+        std::mt19937 engine;
+    };
+}
+
+static std::string base36(int value);
+
+std::string bench::generateChart(const ChartConfig &config)
+{
+    static const char *const lanes[16] = {"16", "11", "12", "13", "14", "15", "18", "19", "26", "21", "22", "23", "24", "25", "28", "29"};
+
+    Random random(config.seed);
+    std::string text;
+    char line[64];
+
+    text += "#PLAYER 1\n#GENRE BENCH\n#TITLE Synthetic\n#ARTIST bmsparser_bench\n#BPM 150\n#PLAYLEVEL 12\n#RANK 2\n#TOTAL 300\n";
+    for (int key = 1; key < 1296; key++)
+    {
+        text += "#WAV" + base36(key) + " sound" + std::to_string(key) + ".wav\n";
+    }
+    for (int key = 1; key < 64; key++)
+    {
+        std::snprintf(line, sizeof(line), "#BPM%s %.2f\n", base36(key).c_str(), 80 + key * 3.75);
+        text += line;
+    }
+    for (int key = 1; key < 16; key++)
+    {
+        text += "#STOP" + base36(key) + " " + std::to_string(key * 12) + "\n";
+    }
+
+    int channels = std::min(std::max(config.channels, 1), 16);
+    std::vector<bool> longLanes(channels);
+    for (int lane = 0; lane < channels; lane++)
+    {
+        longLanes[lane] = random.chance(config.longNotes);
+    }
+
+    std::vector<int> randomMeasures;
+    for (int i = 0; i < config.randoms && config.measures > 0; i++)
+    {
+        randomMeasures.push_back((int)((long long)config.measures * (i * 2 + 1) / (config.randoms * 2)));
+    }
+
+    // Writes one channel line with each token holding a key with the chance given.
+    auto channel = [&](int measure, const std::string &name, float fill, int keys)
+    {
+        std::snprintf(line, sizeof(line), "#%03d%s:", measure, name.c_str());
+        text += line;
+        for (int i = 0; i < config.resolution; i++)
+        {
+            text += random.chance(fill) ? base36(random.below(keys) + 1) : "00";
+        }
+        text += '\n';
+    };
+    auto measureLines = [&](int measure)
+    {
+        if (random.chance(config.signatures))
+        {
+            std::snprintf(line, sizeof(line), "#%03d02:%s\n", measure, random.below(2) ? "0.75" : "1.5");
+            text += line;
+        }
+        channel(measure, "01", config.fill / 2, 1295);
+        channel(measure, "04", 1.0f / config.resolution, 1295);
+        if (random.chance(config.bpmChanges))
+        {
+            std::snprintf(line, sizeof(line), "#%03d08:%s\n", measure, base36(random.below(63) + 1).c_str());
+            text += line;
+        }
+        if (random.chance(config.stops))
+        {
+            std::snprintf(line, sizeof(line), "#%03d09:00%s\n", measure, base36(random.below(15) + 1).c_str());
+            text += line;
+        }
+        for (int lane = 0; lane < channels; lane++)
+        {
+            std::string name = lanes[lane];
+            if (longLanes[lane])
+            {
+                name[0] = name[0] == '1' ? '5' : '6';
+            }
+            channel(measure, name, config.fill, 1295);
+        }
+    };
+
+    size_t next = 0;
+    for (int measure = 0; measure < config.measures; measure++)
+    {
+        if (next < randomMeasures.size() && randomMeasures[next] == measure)
+        {
+            next++;
+            text += "#RANDOM 2\n#IF 1\n";
+            measureLines(measure);
+            text += "#ENDIF\n#IF 2\n";
+            measureLines(measure);
+            text += "#ENDIF\n";
+        }
+        else
+        {
+            measureLines(measure);
+        }
+    }
+
+    return text;
+}
+
+std::string bench::generateShiftJIS(size_t bytes, unsigned int seed)
+{
+    static const char *const words[] = {
+        "譜面", "ハイスピード", "ロングノート", "テスト", "\xe2\x99\xaa", "[ANOTHER]", "feat.", " ", " - ", "夜明けの空",
+        "ビートマニア", "Remix", "(Original Mix)", "心", "東京", "song", "01", "Lv.12", "☆", "サウンド",
+    };
+
+    Random random(seed);
+    std::string utf8;
+    while (utf8.length() < bytes)
+    {
+        utf8 += words[random.below(sizeof(words) / sizeof(words[0]))];
+    }
+    return bms::utf8_to_sjis(utf8);
+}
+
+static std::string base36(int value)
+{
+    const char *digits = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    return std::string{digits[value / 36 % 36], digits[value % 36]};
+}
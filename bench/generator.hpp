@@ -0,0 +1,59 @@
+#ifndef __BMSPARSER_BENCH_GENERATOR_HPP__
+#define __BMSPARSER_BENCH_GENERATOR_HPP__
+
+#include <string>
+
+namespace bench
+{
+    /// Synthetic Chart Settings Class
+    class ChartConfig
+    {
+    public:
+        /// Number of measures
+        int measures = 200;
+
+        /// Tokens per channel line
+        int resolution = 16;
+
+        /// Note lanes used, up to 16: scratch and keys of 1P, then of 2P
+        int channels = 8;
+
+        /// Chance of each token holding an object
+        float fill = 0.5f;
+
+        /// Chance of a measure having a BPM change
+        float bpmChanges = 0.1f;
+
+        /// Chance of a measure having a STOP
+        float stops = 0.05f;
+
+        /// Chance of a lane using long note channels
+        float longNotes = 0.2f;
+
+        /// Chance of a measure having a signature other than 1
+        float signatures = 0.05f;
+
+        /// Measures wrapped in #RANDOM blocks with two alternatives each
+        int randoms = 0;
+
+        /// Seed, the same settings and seed always give the same chart
+        unsigned int seed = 1;
+    };
+
+    /**
+     * Generate a chart.
+     * \param config Settings
+     * \return Content of the .bms file
+     */
+    std::string generateChart(const ChartConfig &config);
+
+    /**
+     * Generate Shift_JIS text like chart headers: ASCII mixed with kana and kanji.
+     * \param bytes Approximate size
+     * \param seed Seed
+     * \return Shift_JIS text
+     */
+    std::string generateShiftJIS(size_t bytes, unsigned int seed);
+}
+
+#endif
@@ -3,9 +3,42 @@
 
 #include <string>
 #include <vector>
+#include <utility>
+#include <cstdint>
 
 namespace bms
 {
+    /// Number of lanes: 9 lines for each of 2 players, lane (player - 1) * 9 + (line - 1)
+    const int LANES = 18;
+
+    /// Fraction Class, an exact position in measures
+    class Fraction
+    {
+    public:
+        /// Measure Number
+        int measure;
+
+        /// Numerator of the offset in the measure
+        int num;
+
+        /// Denominator of the offset in the measure, reduced with num
+        int den;
+
+        /**
+         * Compare exactly.
+         * \param other Fraction
+         * \return Whether this is before other
+         */
+        bool operator<(const Fraction &other) const;
+
+        /**
+         * Compare exactly.
+         * \param other Fraction
+         * \return Whether this is at the same position as other
+         */
+        bool operator==(const Fraction &other) const;
+    };
+
     /// Object Class
     class Obj
     {
@@ -35,6 +68,12 @@ namespace bms
         /// Time it will be executed
         float time;
 
+        /// Exact position
+        Fraction fraction;
+
+        /// Time it will be executed, in nanoseconds, computed in double precision
+        int64_t timeNs;
+
         union
         {
             /// Info for BGM Object
@@ -132,6 +171,101 @@ namespace bms
         float time2pos(float time) const;
     };
 
+    /// BGA Event Class
+    class BgaEvent
+    {
+    public:
+        /// Time the image is shown
+        float time;
+
+        /// BMP Index
+        int key;
+    };
+
+    /// Bar Line Class
+    class BarLine
+    {
+    public:
+        /// Position of the line
+        float pos;
+
+        /// Time the line reaches the judge line
+        float time;
+
+        /// true: measure line, false: beat line
+        bool measure;
+    };
+
+    /// Chart Statistics Class
+    class ChartStats
+    {
+    public:
+        /// Playable notes, a long note counts once
+        int notes;
+
+        /// Long notes
+        int longNotes;
+
+        /// Bombs
+        int mines;
+
+        /// Playable notes on the scratch lanes
+        int scratches;
+
+        /// Lowest BPM held for any time
+        float minBpm;
+
+        /// Highest BPM held for any time
+        float maxBpm;
+
+        /// BPM held longest
+        float mainBpm;
+
+        /// Time of the last object
+        float length;
+    };
+
+    /// Memory Usage Class, heap and object bytes held by each part of a chart
+    class MemoryUsage
+    {
+    public:
+        /// The Chart object itself
+        size_t chart;
+
+        /// Filename, genre, title, artist, subtitle, subartist, stagefile and banner
+        size_t strings;
+
+        /// WAV paths: the 1296-entry array and the paths in it
+        size_t wavs;
+
+        /// BMP paths: the 1296-entry array and the paths in it
+        size_t bmps;
+
+        /// Objs, by capacity
+        size_t objs;
+
+        /// Sectors, by capacity
+        size_t sectors;
+
+        /// Signatures and measure starts, by capacity
+        size_t measures;
+
+        /// BGA events and BMP order, by capacity
+        size_t bgas;
+
+        /// Bar lines, by capacity
+        size_t barLines;
+
+        /// Chosen #RANDOM values, by capacity
+        size_t randoms;
+
+        /**
+         * Sum every part.
+         * \return Total bytes
+         */
+        size_t total() const;
+    };
+
     /// Chart Class
     class Chart
     {
@@ -204,8 +338,14 @@ namespace bms
         /// Path to the BMP files
         std::string *bmps;
 
-        /// Signatures
-        float *signatures;
+        /// Measure lengths other than 1, as (measure, length) in measure order
+        std::vector<std::pair<int, float>> signatures;
+
+        /// Number of measures, up to the last one written in the chart
+        int measures;
+
+        /// Position of the start of each measure, with one more entry than measures for the end of the last one
+        std::vector<float> measureStarts;
 
         /// Objs
         std::vector<Obj> objs;
@@ -213,13 +353,48 @@ namespace bms
         /// Sectors
         std::vector<Sector> sectors;
 
+        /**
+         * BGA events per layer, in time order, indexed by Obj::bmp.layer + 1
+         * 0: Poor BGA
+         * 1: BGA Base
+         * 2: BGA Layer
+         */
+        std::vector<BgaEvent> bgas[3];
+
+        /// BMP Indices in the order they are first shown
+        std::vector<int> bmpOrder;
+
+        /// Statistics, filled by parseBMS
+        ChartStats stats;
+
+        /// Value chosen for each #RANDOM, in order
+        std::vector<int> randoms;
+
+        /// Measure lines and quarter-note beat lines up to the end of the last measure, in position order
+        std::vector<BarLine> barLines;
+
         Chart();
         Chart(const Chart &chart);
 
         ~Chart();
 
+        /**
+         * Measure the memory held by the chart.
+         * Allocator overhead is not included.
+         * \return Bytes per part
+         */
+        MemoryUsage memoryUsage() const;
+
+        /**
+         * Get the length of a measure.
+         * \param measure Measure Number
+         * \return Length, 1 unless the measure has a signature
+         */
+        float signature(int measure) const;
+
         /**
          * Convert fraction to position.
+         * Measures outside the chart are taken to have length 1.
          * \param frac Fraction
          * \return Position
          */
@@ -245,15 +420,146 @@ namespace bms
          * \return Position
          */
         float time2pos(float time) const;
+
+        /**
+         * Find the bar lines between two positions.
+         * \param posBegin Position of the judge line
+         * \param posEnd Position of the top of the lanes
+         * \return First line at or after posBegin and first line at or after posEnd
+         */
+        std::pair<std::vector<BarLine>::const_iterator, std::vector<BarLine>::const_iterator> barLinesBetween(float posBegin, float posEnd) const;
+    };
+
+    /// Parse Diagnostic Class
+    class Diagnostic
+    {
+    public:
+        /// Kind of the problem
+        enum class Kind : unsigned char
+        {
+            /// The file cannot be read.
+            FILE,
+
+            /// A number cannot be read; the token or line is skipped.
+            NUMBER,
+
+            /// A number is out of range; the token or line is skipped.
+            RANGE,
+
+            /// #ELSE or #ENDIF without #IF; the line is ignored.
+            UNMATCHED,
+        };
+
+        /// Line Number, starting from 1, 0 for the whole file
+        int line;
+
+        /// Column of the token, starting from 1, 0 for the whole line
+        int column;
+
+        /// Kind of the problem
+        Kind kind;
+    };
+
+    /// Parse Result Class
+    class ParseResult
+    {
+    public:
+        /// Parsed chart, nullptr if the file cannot be read
+        Chart *chart;
+
+        /// Problems found, in line order
+        std::vector<Diagnostic> diagnostics;
+    };
+
+    /// Parse Statistics Class
+    class ParseStats
+    {
+    public:
+        /// Time spent reading the file, in nanoseconds
+        int64_t readNs;
+
+        /// Time spent splitting lines and reading headers, in nanoseconds
+        int64_t tokenizeNs;
+
+        /// Time spent turning channel data into objects, in nanoseconds
+        int64_t decodeNs;
+
+        /// Time spent sorting objects and speed changes, in nanoseconds
+        int64_t sortNs;
+
+        /// Time spent building sectors, in nanoseconds
+        int64_t sectorsNs;
+
+        /// Time spent giving objects their positions and times, and building bar lines and statistics, in nanoseconds
+        int64_t timingNs;
+
+        /// Size of the file
+        size_t bytes;
+
+        /// Lines in the file
+        int lines;
+
+        /// Command lines other than channel data, including every #RANDOM, #IF, #ELSE and #ENDIF
+        int headerLines;
+
+        /// Channel data lines, #xxx02 included
+        int channelLines;
+
+        /// Lines skipped by #IF blocks, other than the block directives
+        int skippedLines;
+
+        /// Objects of each type, indexed by Obj::Type
+        int objs[5];
+
+        /// Sectors
+        int sectors;
     };
 
     /**
      * Parse .bms file.
      * \param file Path to the file
      *
-     * \throw std::invalid_argument Cannot read the file
+     * \throw std::invalid_argument Cannot read the file, or a number is malformed
+     * \throw std::out_of_range A number is out of range
      */
     Chart *parseBMS(const std::string &file);
+
+    /**
+     * Parse .bms file with chosen #RANDOM values.
+     * \param file Path to the file
+     * \param randoms Value for each #RANDOM in order, as in Chart::randoms; missing ones are rolled
+     *
+     * \throw std::invalid_argument Cannot read the file, or a number is malformed
+     * \throw std::out_of_range A number is out of range
+     */
+    Chart *parseBMS(const std::string &file, const std::vector<int> &randoms);
+
+    /**
+     * Parse .bms file with chosen #RANDOM values, measuring each phase.
+     * \param file Path to the file
+     * \param randoms Value for each #RANDOM in order, as in Chart::randoms; missing ones are rolled
+     * \param stats Filled with phase durations and counts, or nullptr to measure nothing
+     *
+     * \throw std::invalid_argument Cannot read the file, or a number is malformed
+     * \throw std::out_of_range A number is out of range
+     */
+    Chart *parseBMS(const std::string &file, const std::vector<int> &randoms, ParseStats *stats);
+
+    /**
+     * Parse .bms file without throwing.
+     * Malformed numbers are skipped and reported instead of aborting the parse.
+     * \param file Path to the file
+     * \return Chart and diagnostics
+     */
+    ParseResult tryParseBMS(const std::string &file);
+
+    /**
+     * Parse .bms file with chosen #RANDOM values without throwing.
+     * \param file Path to the file
+     * \param randoms Value for each #RANDOM in order, as in Chart::randoms; missing ones are rolled
+     * \return Chart and diagnostics
+     */
+    ParseResult tryParseBMS(const std::string &file, const std::vector<int> &randoms);
 }
 
 #endif
\ No newline at end of file
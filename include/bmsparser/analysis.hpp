@@ -0,0 +1,116 @@
+#ifndef __BMSPARSER_ANALYSIS_HPP__
+#define __BMSPARSER_ANALYSIS_HPP__
+
+#include <bmsparser.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace bms
+{
+    /// Note Density Class
+    class Density
+    {
+    public:
+        /// Notes starting in each second
+        std::vector<int> perSecond;
+
+        /// Notes starting in each measure
+        std::vector<int> perMeasure;
+
+        /// Number of seconds holding each note count, indexed by note count
+        std::vector<int> distribution;
+
+        /// Highest notes per second over a sliding window
+        float peak;
+
+        /// Start of the window with the highest density
+        float peakTime;
+
+        /// Notes per second over the whole chart
+        float average;
+
+        /// Notes per second averaged over equal slices of the chart
+        std::vector<float> curve;
+    };
+
+    /// Chord Row Class
+    class ChordRow
+    {
+    public:
+        /// Time of the row
+        float time;
+
+        /**
+         * Lanes with a note starting at this time.
+         * Bit (player - 1) * 9 + (line - 1) is set for each note.
+         */
+        uint32_t mask;
+    };
+
+    /// Pattern Statistics Class
+    class PatternStats
+    {
+    public:
+        /// Number of chord rows
+        int rows;
+
+        /// Notes repeating on the lane of the previous row
+        int jacks;
+
+        /// Rows repeating a lane of the previous row
+        int jackRows;
+
+        /// Rows equal to the row two before, sharing no lane with the row between
+        int trillRows;
+
+        /// Number of rows by number of notes, indexed by chord size
+        std::vector<int> chordSizes;
+
+        /// Rows with a scratch note
+        int scratchRows;
+
+        /// Scratch rows per second
+        float scratchDensity;
+
+        /// Long notes over playable notes
+        float longNoteRatio;
+
+        /// Rows played with the left hand only
+        int leftRows;
+
+        /// Rows played with the right hand only
+        int rightRows;
+
+        /// Rows needing both hands
+        int bothRows;
+    };
+
+    /**
+     * Compute the note density of a chart.
+     * Playable notes are counted, long notes once.
+     * \param chart Chart
+     * \param window Length of the sliding window used for the peak, in seconds, must be positive
+     * \param points Number of slices in the downsampled curve
+     * \return Density, all zero if the chart has no notes or window is not positive
+     */
+    Density analyzeDensity(const Chart &chart, float window, size_t points);
+
+    /**
+     * Group the playable notes of a chart into rows of simultaneous notes.
+     * \param chart Chart
+     * \return Rows in time order
+     */
+    std::vector<ChordRow> chordRows(const Chart &chart);
+
+    /**
+     * Classify the patterns of a chart.
+     * For Single charts the left hand plays scratch and keys 1~3, the right hand keys 4~7.
+     * For Dual charts each hand plays one side.
+     * \param chart Chart
+     * \return Statistics
+     */
+    PatternStats analyzePatterns(const Chart &chart);
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef __BMSPARSER_AUDIO_HPP__
+#define __BMSPARSER_AUDIO_HPP__
+
+#include <bmsparser.hpp>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace bms
+{
+    /// Audio Event Class
+    class AudioEvent
+    {
+    public:
+        /// Sample the keysound starts at
+        int64_t sample;
+
+        /// WAV Index
+        int key;
+
+        /// BGM or NOTE
+        Obj::Type source;
+    };
+
+    /// Audio Trigger Class
+    class AudioTrigger
+    {
+    public:
+        /// Frame in the buffer the keysound starts at
+        uint32_t offset;
+
+        /// WAV Index
+        int key;
+
+        /// BGM or NOTE
+        Obj::Type source;
+    };
+
+    /// Audio Stream Class
+    class AudioStream
+    {
+    public:
+        /// Sample rate the events are built for
+        int sampleRate;
+
+        /// Keysound triggers of BGM objects and of notes other than long note ends, in sample order
+        std::vector<AudioEvent> events;
+
+        /**
+         * Build the stream of a chart.
+         * \param chart Chart
+         * \param sampleRate Sample rate
+         */
+        AudioStream(const Chart &chart, int sampleRate);
+    };
+
+    /**
+     * Audio Cursor Class
+     *
+     * Hands out the events of consecutive buffers to the audio callback.
+     * read() belongs to the audio thread and neither locks nor allocates;
+     * seek() may be called from any thread and takes effect on the next read().
+     */
+    class AudioCursor
+    {
+    public:
+        /**
+         * Create a cursor at sample 0.
+         * The stream must outlive the cursor.
+         * \param stream Audio stream
+         */
+        AudioCursor(const AudioStream &stream);
+
+        /**
+         * Request a jump.
+         * \param sample Sample the next buffer starts at
+         */
+        void seek(int64_t sample);
+
+        /**
+         * Read the events of the next buffer and move past it.
+         * Events that do not fit are returned by the next call with offset 0.
+         * \param frames Length of the buffer
+         * \param triggers Receives the events
+         * \param capacity Number of events triggers holds
+         * \return Number of events written
+         */
+        size_t read(uint32_t frames, AudioTrigger *triggers, size_t capacity);
+
+        /// Sample the next buffer starts at, readable from any thread
+        int64_t position() const;
+
+    private:
+        const AudioStream &stream;
+
+        /// Next event to hand out, owned by the audio thread
+        size_t next;
+
+        std::atomic<int64_t> playhead;
+
+        /// Requested jump, or INT64_MIN
+        std::atomic<int64_t> target;
+    };
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef __BMSPARSER_BGA_HPP__
+#define __BMSPARSER_BGA_HPP__
+
+#include <bmsparser.hpp>
+#include <cstddef>
+
+namespace bms
+{
+    /**
+     * BGA Cursor Class
+     *
+     * Tracks the image shown on each BGA layer while time moves forward.
+     * Moving forward is amortized O(1) per frame, moving backward seeks.
+     */
+    class BgaCursor
+    {
+    public:
+        /**
+         * Create a cursor at the start of the chart.
+         * The chart must outlive the cursor.
+         * \param chart Chart
+         */
+        BgaCursor(const Chart &chart);
+
+        /**
+         * Move the cursor to a time.
+         * \param time Time
+         */
+        void update(float time);
+
+        /**
+         * Move the cursor to a time with binary search.
+         * \param time Time
+         */
+        void seek(float time);
+
+        /**
+         * Get the image shown on a layer.
+         * \param layer -1: Poor BGA, 0: BGA Base, 1: BGA Layer
+         * \return BMP Index, 0 if nothing is shown yet
+         */
+        int key(int layer) const;
+
+    private:
+        const Chart &chart;
+
+        float time;
+
+        /// Number of events passed on each layer
+        size_t passed[3];
+    };
+}
+
+#endif
@@ -2,10 +2,82 @@
 #define __BMSPARSER_CONVERT_HPP__
 
 #include <string>
+#include <vector>
 
 namespace bms
 {
+    /// Legacy encodings used by BMS metadata
+    enum class Encoding
+    {
+        /// Shift_JIS (CP932 subset)
+        ShiftJIS,
+
+        /// CP949 (EUC-KR with Unified Hangul Code extension)
+        CP949,
+    };
+
     std::string sjis_to_utf8(const std::string &input);
+
+    /**
+     * Convert Shift_JIS to UTF-8, appending to a buffer.
+     * \param input Shift_JIS string
+     * \param output Buffer the UTF-8 result is appended to
+     */
+    void sjis_to_utf8(const std::string &input, std::string &output);
+
+    /**
+     * Convert UTF-8 to Shift_JIS.
+     * ASCII is passed through unchanged, so path separators survive.
+     * Characters without a Shift_JIS code become '?'.
+     * \param input UTF-8 string
+     * \return Shift_JIS string
+     */
+    std::string utf8_to_sjis(const std::string &input);
+
+    /**
+     * Convert UTF-8 to Shift_JIS, appending to a buffer.
+     * \param input UTF-8 string
+     * \param output Buffer the Shift_JIS result is appended to
+     */
+    void utf8_to_sjis(const std::string &input, std::string &output);
+
+    /**
+     * Convert many UTF-8 strings to Shift_JIS at once.
+     * \param inputs UTF-8 strings
+     * \return Shift_JIS strings, in the same order
+     */
+    std::vector<std::string> utf8_to_sjis(const std::vector<std::string> &inputs);
+
+    std::string cp949_to_utf8(const std::string &input);
+
+    /**
+     * Convert CP949 to UTF-8, appending to a buffer.
+     * \param input CP949 string
+     * \param output Buffer the UTF-8 result is appended to
+     */
+    void cp949_to_utf8(const std::string &input, std::string &output);
+
+    /**
+     * Guess whether a string is Shift_JIS or CP949.
+     * Ties and pure ASCII resolve to Shift_JIS.
+     * \param input Raw string
+     * \return Detected encoding
+     */
+    Encoding detect_encoding(const std::string &input);
+
+    /**
+     * Convert a string to UTF-8 using the detected encoding.
+     * \param input Raw string
+     * \return UTF-8 string
+     */
+    std::string to_utf8(const std::string &input);
+
+    /**
+     * Convert a string to UTF-8 using the detected encoding, appending to a buffer.
+     * \param input Raw string
+     * \param output Buffer the UTF-8 result is appended to
+     */
+    void to_utf8(const std::string &input, std::string &output);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef __BMSPARSER_GAUGE_HPP__
+#define __BMSPARSER_GAUGE_HPP__
+
+#include <bmsparser.hpp>
+#include <bmsparser/judge.hpp>
+#include <vector>
+#include <cstddef>
+
+namespace bms
+{
+    /// Gauge Class
+    class Gauge
+    {
+    public:
+        /// Type of the gauge
+        enum class Type
+        {
+            GROOVE,
+            EASY,
+            HARD,
+            EXHARD,
+            HAZARD,
+        } type;
+
+        /// Value at the start
+        float initial;
+
+        /// Lowest value
+        float min;
+
+        /// Highest value
+        float max;
+
+        /// Value needed at the end to clear, ignored by survival gauges
+        float border;
+
+        /// Whether reaching 0 fails the chart
+        bool survival;
+
+        /// Change for each judgement code: PGREAT, GREAT, GOOD, BAD, POOR, empty POOR
+        float increments[6];
+
+        /// Below this value, decreases are scaled by lowFactor
+        float lowThreshold;
+
+        /// Scale of decreases below lowThreshold
+        float lowFactor;
+
+        /**
+         * Create a gauge for a chart.
+         * Increments of the groove and easy gauges scale with Chart::total and the note count.
+         * \param type Type of the gauge
+         * \param chart Chart
+         */
+        Gauge(Type type, const Chart &chart);
+
+        /**
+         * Apply one judgement.
+         * \param value Current value
+         * \param judgement Judgement code, PGREAT~EMPTY_POOR as (unsigned char)Judgement
+         * \return New value
+         */
+        float apply(float value, unsigned char judgement) const;
+
+        /**
+         * Evaluate a judgement sequence.
+         * \param judgements Judgement codes in order
+         * \return Final value
+         */
+        float evaluate(const std::vector<unsigned char> &judgements) const;
+
+        /**
+         * Evaluate many judgement sequences of the same length at once.
+         * Sequences are interleaved so the loop over replays vectorizes.
+         * \param judgements Code of step s of replay r at judgements[s * replays + r]
+         * \param steps Length of each sequence
+         * \param replays Number of sequences
+         * \param values Receives the final value of each sequence
+         */
+        void evaluate(const unsigned char *judgements, size_t steps, size_t replays, float *values) const;
+
+        /**
+         * Check the clear condition.
+         * \param value Final value
+         * \return Whether the chart is cleared
+         */
+        bool cleared(float value) const;
+    };
+}
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef __BMSPARSER_JUDGE_HPP__
+#define __BMSPARSER_JUDGE_HPP__
+
+#include <bmsparser.hpp>
+#include <vector>
+#include <cstddef>
+
+namespace bms
+{
+    /// Judgement of a note
+    enum class Judgement
+    {
+        PGREAT,
+        GREAT,
+        GOOD,
+        BAD,
+        POOR,
+
+        /// Press too early for any note, which does not break the combo
+        EMPTY_POOR,
+
+        /// Nothing was judged
+        NONE,
+    };
+
+    /// Judge Windows Class
+    class JudgeWindows
+    {
+    public:
+        /// Largest offset, in seconds, for each judgement
+        float pgreat, great, good, bad;
+
+        /// How early a press still counts as an empty POOR
+        float poor;
+
+        /**
+         * Create windows.
+         * \param pgreat PGREAT window
+         * \param great GREAT window
+         * \param good GOOD window
+         * \param bad BAD window
+         * \param poor Empty POOR window
+         */
+        JudgeWindows(float pgreat, float great, float good, float bad, float poor) : pgreat(pgreat), great(great), good(good), bad(bad), poor(poor) {}
+
+        /**
+         * Create windows for a #RANK value.
+         * \param rank Chart::rank
+         */
+        JudgeWindows(int rank);
+    };
+
+    /// Judge Note Class
+    class JudgeNote
+    {
+    public:
+        /// Time of the note
+        float time;
+
+        /// Time of the end of the long note, negative if it is not a long note
+        float end;
+    };
+
+    /// Judge Mine Class
+    class JudgeMine
+    {
+    public:
+        /// Time of the mine
+        float time;
+
+        /// Damage
+        int damage;
+    };
+
+    /**
+     * Judge Table Class
+     *
+     * Per-lane note and mine queues of a chart, shared by any number of judges.
+     * Lane (player - 1) * 9 + (line - 1) holds the notes of that player and line.
+     */
+    class JudgeTable
+    {
+    public:
+        /// Notes in time order, per lane
+        std::vector<JudgeNote> notes[LANES];
+
+        /// Mines in time order, per lane
+        std::vector<JudgeMine> mines[LANES];
+
+        /// Number of notes over all lanes
+        int total;
+
+        /**
+         * Build the queues of a chart.
+         * \param chart Chart
+         */
+        JudgeTable(const Chart &chart);
+    };
+
+    /**
+     * Judge Class
+     *
+     * Matches key events against a judge table. Events must come in time order.
+     * Each input costs amortized O(1). Nothing is allocated after construction,
+     * except by appending to sequence when it is set.
+     */
+    class Judge
+    {
+    public:
+        /// Number of notes for each judgement, indexed by Judgement
+        int counts[5];
+
+        /// Presses too early for any note, which do not break the combo
+        int emptyPoors;
+
+        /// Current combo
+        int combo;
+
+        /// Highest combo
+        int maxCombo;
+
+        /// Damage taken from mines
+        int damage;
+
+        /// Last judgement recorded
+        Judgement last;
+
+        /// If set, every judgement is appended to it as (unsigned char)Judgement, EMPTY_POOR included.
+        /// Reserve JudgeTable::total codes and some more for empty POORs to avoid growing it during play.
+        std::vector<unsigned char> *sequence;
+
+        /**
+         * Create a judge.
+         * The table must outlive the judge.
+         * \param table Judge table
+         * \param windows Judge windows
+         */
+        Judge(const JudgeTable &table, const JudgeWindows &windows);
+
+        /// Start over from the beginning of the chart.
+        void reset();
+
+        /**
+         * Press a key.
+         * \param lane Lane
+         * \param time Time of the press
+         * \return Judgement of the pressed note, tentative for a long note, EMPTY_POOR if it is too early, or NONE
+         */
+        Judgement press(int lane, float time);
+
+        /**
+         * Release a key.
+         * \param lane Lane
+         * \param time Time of the release
+         * \return Judgement of the held long note
+         */
+        Judgement release(int lane, float time);
+
+        /**
+         * Judge every note and mine passed by a time.
+         * Call with a time past the chart to finish it.
+         * \param time Time
+         */
+        void update(float time);
+
+        /// EX Score
+        int exScore() const;
+
+    private:
+        const JudgeTable &table;
+
+        JudgeWindows windows;
+
+        /// Index of the next note and mine, per lane
+        size_t nextNote[LANES], nextMine[LANES];
+
+        /// Long note held, per lane, or -1
+        long holding[LANES];
+
+        /// Tentative judgement of the held long note, per lane
+        Judgement holdJudgement[LANES];
+
+        /// Whether the key is down, per lane
+        bool down[LANES];
+
+        /// Earliest time anything can be due, update does nothing before it
+        float deadline;
+
+        void record(Judgement judgement);
+    };
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef __BMSPARSER_KEYSOUND_HPP__
+#define __BMSPARSER_KEYSOUND_HPP__
+
+#include <bmsparser.hpp>
+#include <vector>
+#include <utility>
+
+namespace bms
+{
+    /// Usage of a WAV key over the chart
+    class KeysoundUsage
+    {
+    public:
+        /// WAV Index
+        int key;
+
+        /// Time of the first object using the key
+        float first;
+
+        /// Time of the last object using the key
+        float last;
+
+        /// Number of objects using the key
+        int count;
+    };
+
+    /// Keysound Schedule Event Class
+    class KeysoundEvent
+    {
+    public:
+        /// Type of the event
+        enum class Type
+        {
+            /// The key must be loaded by this time.
+            LOAD,
+
+            /// The key can be evicted after this time.
+            EVICT,
+        } type;
+
+        /// Time of the event, negative if it is before the chart starts
+        float time;
+
+        /// WAV Index
+        int key;
+    };
+
+    /// Keysound Schedule Class
+    class KeysoundSchedule
+    {
+    public:
+        /// Usage of every used key, in first-use order
+        std::vector<KeysoundUsage> usages;
+
+        /// Load and evict events, in time order, evictions first on ties
+        std::vector<KeysoundEvent> events;
+    };
+
+    /// Keysound Retrigger Class
+    class KeysoundRetrigger
+    {
+    public:
+        /// Time of the new trigger
+        float time;
+
+        /// WAV Index
+        int key;
+
+        /// How much of the previous voice was cut
+        float cut;
+    };
+
+    /// Polyphony Profile Class
+    class PolyphonyProfile
+    {
+    public:
+        /// Highest number of voices playing at once
+        int peak;
+
+        /// First time the peak is reached
+        float peakTime;
+
+        /// Voice count over time: each entry holds from its time until the next entry
+        std::vector<std::pair<float, int>> curve;
+
+        /// Time spent at each voice count, indexed by voice count
+        std::vector<float> histogram;
+
+        /// Triggers that cut a voice of the same key still playing
+        std::vector<KeysoundRetrigger> retriggers;
+
+        /**
+         * Time-weighted percentile of the voice count.
+         * \param p Fraction between 0 and 1
+         * \return Smallest voice count held for at least that fraction of the time
+         */
+        int percentile(float p) const;
+    };
+
+    /**
+     * Compute when each keysound has to be resident.
+     * BGM, NOTE and INVISIBLE objects are considered. A key is kept from
+     * lookahead before each use until release after it; when that window
+     * does not reach the next use, the key is evicted and loaded again.
+     * \param chart Chart
+     * \param lookahead How long before a use the key must be loaded
+     * \param release How long after a use the key must stay loaded
+     * \return Schedule
+     */
+    KeysoundSchedule scheduleKeysounds(const Chart &chart, float lookahead, float release);
+
+    /**
+     * Compute the number of voices playing over time.
+     * BGM objects and NOTE objects other than long note ends trigger voices.
+     * A trigger cuts the voice of the same key if it is still playing.
+     * \param chart Chart
+     * \param durations Length of each WAV by index, may be shorter than 1296
+     * \param defaultDuration Length used for keys without a positive entry in durations, 0 if not positive
+     * \return Profile
+     */
+    PolyphonyProfile profilePolyphony(const Chart &chart, const std::vector<float> &durations, float defaultDuration);
+}
+
+#endif
\ No newline at end of file
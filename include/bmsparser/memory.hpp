@@ -0,0 +1,50 @@
+#ifndef __BMSPARSER_MEMORY_HPP__
+#define __BMSPARSER_MEMORY_HPP__
+
+#include <cstddef>
+
+namespace bms
+{
+    /// Allocation Statistics Class
+    class AllocationStats
+    {
+    public:
+        /// Allocations made
+        size_t count;
+
+        /// Bytes allocated in total
+        size_t bytes;
+
+        /// Bytes allocated and not freed yet
+        size_t live;
+
+        /// Highest live bytes since the start or the last resetAllocationPeak
+        size_t peak;
+    };
+
+    /**
+     * Get the allocations counted so far.
+     * Counting is opt-in: the BMSPARSER_COUNT_ALLOCATIONS CMake option compiles
+     * src/alloc_count.cpp into each program linking bmsparser, which replaces the
+     * global operator new and delete. Otherwise every field stays 0.
+     * \return Statistics
+     */
+    AllocationStats allocationStats();
+
+    /// Start the peak over from the bytes live now.
+    void resetAllocationPeak();
+
+    /**
+     * Count an allocation, called by the replaced operator new.
+     * \param size Bytes allocated
+     */
+    void countAllocation(size_t size);
+
+    /**
+     * Count a deallocation, called by the replaced operator delete.
+     * \param size Bytes freed
+     */
+    void countDeallocation(size_t size);
+}
+
+#endif
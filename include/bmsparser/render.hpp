@@ -0,0 +1,155 @@
+#ifndef __BMSPARSER_RENDER_HPP__
+#define __BMSPARSER_RENDER_HPP__
+
+#include <bmsparser.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace bms
+{
+    /// Lane Object Class
+    class LaneObj
+    {
+    public:
+        /// Position of the object
+        float pos;
+
+        /// Position of the end of the long note, equal to pos otherwise
+        float end;
+
+        /// WAV Index, or damage for bombs
+        int key;
+
+        /// Index in Chart::objs
+        size_t index;
+    };
+
+    /// Lane Span Class
+    class LaneSpan
+    {
+    public:
+        /// First object in the span
+        const LaneObj *begin;
+
+        /// Past the last object in the span
+        const LaneObj *end;
+    };
+
+    /// Visible Range Class
+    class VisibleRange
+    {
+    public:
+        /// Spans of notes per lane, empty if not requested
+        LaneSpan notes[LANES];
+
+        /// Spans of invisible notes per lane, empty if not requested
+        LaneSpan invisibles[LANES];
+
+        /// Spans of bombs per lane, empty if not requested
+        LaneSpan bombs[LANES];
+    };
+
+    /**
+     * Lane Index Class
+     *
+     * Position-sorted objects of each lane, with long notes merged into one object.
+     */
+    class LaneIndex
+    {
+    public:
+        /// Notes per lane
+        std::vector<LaneObj> notes[LANES];
+
+        /// Invisible notes per lane
+        std::vector<LaneObj> invisibles[LANES];
+
+        /// Bombs per lane
+        std::vector<LaneObj> bombs[LANES];
+
+        /**
+         * Build the index of a chart.
+         * \param chart Chart
+         */
+        LaneIndex(const Chart &chart);
+
+        /**
+         * Find the objects between two positions.
+         * Long notes that start before the window but reach into it are included.
+         * Costs O(log n) per lane and type, plus nothing per object.
+         * \param posBegin Position of the judge line
+         * \param posEnd Position of the top of the lanes, not below posBegin
+         * \param typeMask Bits 1 << (int)Obj::Type for NOTE, INVISIBLE and BOMB
+         * \return Spans per lane, all empty if posEnd is below posBegin
+         */
+        VisibleRange visibleRange(float posBegin, float posEnd, unsigned int typeMask) const;
+    };
+
+    /// Note Instance Class, laid out for direct upload as per-instance vertex data
+    class NoteInstance
+    {
+    public:
+        /// Distance above the judge line, in lane heights scaled by hi-speed
+        float y;
+
+        /// Length of the long note in the same units, 0 otherwise
+        float length;
+
+        /// Lane
+        uint16_t lane;
+
+        /// Obj::Type of the object
+        uint16_t type;
+    };
+
+    /**
+     * Render Cursor Class
+     *
+     * Keeps the current sector and the visible span of each lane between frames.
+     * Moving forward only touches the sectors passed and the objects entering or
+     * leaving the window; moving backward steps back through the sectors and seeks.
+     */
+    class RenderCursor
+    {
+    public:
+        /**
+         * Create a cursor.
+         * The chart and the index must outlive the cursor.
+         * \param chart Chart
+         * \param index Lane index of the chart
+         * \param typeMask Bits 1 << (int)Obj::Type for NOTE, INVISIBLE and BOMB
+         */
+        RenderCursor(const Chart &chart, const LaneIndex &index, unsigned int typeMask);
+
+        /**
+         * Fill an instance buffer with the objects visible at a time.
+         * Nothing is allocated.
+         * \param time Time
+         * \param hiSpeed Lane heights per unit of position, must be positive
+         * \param buffer Instance buffer
+         * \param capacity Number of instances the buffer holds
+         * \return Number of instances written, 0 if hiSpeed is not positive
+         */
+        size_t fill(float time, float hiSpeed, NoteInstance *buffer, size_t capacity);
+
+    private:
+        const Chart &chart;
+
+        /// Lane arrays by Obj::Type - NOTE: notes, invisibles, bombs
+        const std::vector<LaneObj> *lanes[3];
+
+        unsigned int typeMask;
+
+        /// Index of the sector of the last frame
+        size_t sector;
+
+        float posBegin;
+
+        /// Visible span of each lane array, as indices
+        size_t first[3][LANES], last[3][LANES];
+
+        void seek(float posBegin, float posEnd);
+    };
+}
+
+#endif
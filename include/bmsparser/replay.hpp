@@ -0,0 +1,65 @@
+#ifndef __BMSPARSER_REPLAY_HPP__
+#define __BMSPARSER_REPLAY_HPP__
+
+#include <bmsparser/judge.hpp>
+#include <vector>
+
+namespace bms
+{
+    /// Replay Input Class
+    class ReplayInput
+    {
+    public:
+        /// Time of the event
+        float time;
+
+        /// Lane, as in JudgeTable
+        int lane;
+
+        /// true: press, false: release
+        bool down;
+    };
+
+    /// Replay Result Class
+    class ReplayResult
+    {
+    public:
+        /// Number of notes for each judgement, indexed by Judgement
+        int counts[5];
+
+        /// Presses too early for any note
+        int emptyPoors;
+
+        /// Highest combo
+        int maxCombo;
+
+        /// EX Score
+        int exScore;
+
+        /// Damage taken from mines
+        int damage;
+    };
+
+    /**
+     * Simulate a replay.
+     * The table must come from the chart parsed with the #RANDOM values of the replay,
+     * see parseBMS(const std::string &, const std::vector<int> &).
+     * \param table Judge table
+     * \param windows Judge windows
+     * \param inputs Key events in time order
+     * \return Result
+     */
+    ReplayResult simulateReplay(const JudgeTable &table, const JudgeWindows &windows, const std::vector<ReplayInput> &inputs);
+
+    /**
+     * Simulate many replays of the same chart in parallel.
+     * \param table Judge table, shared read-only by every thread
+     * \param windows Judge windows
+     * \param replays Key events of each replay
+     * \param threads Number of threads, 0 to use every hardware thread
+     * \return Result of each replay, in the same order
+     */
+    std::vector<ReplayResult> simulateReplays(const JudgeTable &table, const JudgeWindows &windows, const std::vector<std::vector<ReplayInput>> &replays, unsigned int threads);
+}
+
+#endif
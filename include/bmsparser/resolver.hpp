@@ -0,0 +1,63 @@
+#ifndef __BMSPARSER_RESOLVER_HPP__
+#define __BMSPARSER_RESOLVER_HPP__
+
+#include <bmsparser.hpp>
+#include <string>
+#include <unordered_map>
+
+namespace bms
+{
+    /**
+     * Resolver Class
+     *
+     * Maps resource paths written in a chart to files that exist on disk.
+     * Each directory is listed once and indexed by case-folded name and by
+     * case-folded name without extension, so "kick.wav" finds "KICK.ogg".
+     * Keep one resolver per song folder to share the listing between charts.
+     */
+    class Resolver
+    {
+    public:
+        /**
+         * Resolve a resource path.
+         * An exact case-insensitive match is preferred over a match with another extension.
+         * \param path Path as written in the chart, with the chart's folder prepended
+         * \return Path to the existing file, or an empty string if there is none
+         */
+        std::string resolve(const std::string &path);
+
+        /**
+         * Resolve every WAV and BMP path, the stagefile and the banner of a chart.
+         * Paths that cannot be resolved are left unchanged.
+         * \param chart Chart to update
+         */
+        void resolve(Chart &chart);
+
+        /// Forget every directory listed so far.
+        void clear();
+
+    private:
+        struct Directory
+        {
+            /// Path to the directory as it exists on disk, with a trailing separator
+            std::string path;
+
+            /// Case-folded file name to file name
+            std::unordered_map<std::string, std::string> names;
+
+            /// Case-folded file name without extension to file name
+            std::unordered_map<std::string, std::string> stems;
+
+            /// Case-folded directory name to directory name
+            std::unordered_map<std::string, std::string> dirs;
+
+            bool exists;
+        };
+
+        std::unordered_map<std::string, Directory> directories;
+
+        const Directory &directory(const std::string &path);
+    };
+}
+
+#endif
\ No newline at end of file
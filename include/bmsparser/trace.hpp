@@ -0,0 +1,71 @@
+#ifndef __BMSPARSER_TRACE_HPP__
+#define __BMSPARSER_TRACE_HPP__
+
+#include <string>
+#include <cstdint>
+
+/**
+ * Trace hooks are compiled into the library only when BMSPARSER_TRACE is defined,
+ * which the BMSPARSER_TRACE CMake option does. Without it, BMS_TRACE_SCOPE expands
+ * to nothing and writeTrace writes an empty trace.
+ */
+#ifdef BMSPARSER_TRACE
+#define BMS_TRACE_CONCAT_(a, b) a##b
+#define BMS_TRACE_CONCAT(a, b) BMS_TRACE_CONCAT_(a, b)
+#define BMS_TRACE_SCOPE(...) bms::TraceScope BMS_TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
+#else
+#define BMS_TRACE_SCOPE(...)
+#endif
+
+namespace bms
+{
+    /**
+     * Get the time used by trace events.
+     * \return Steady clock time in nanoseconds
+     */
+    int64_t traceClock();
+
+    /**
+     * Record a complete event on the calling thread.
+     * Each thread writes to its own ring buffer without locking; when it is full,
+     * the oldest events are overwritten. The buffer of a thread that exits is
+     * reused by the next new thread, so threads spawned over and over cost no memory.
+     * \param name Name of the event, must outlive the trace
+     * \param begin Start of the event, from traceClock
+     * \param end End of the event, from traceClock
+     * \param detail Text shown with the event, such as a file name, or nullptr; the end is kept if it is long
+     */
+    void traceEvent(const char *name, int64_t begin, int64_t end, const char *detail = nullptr);
+
+    /// Trace Scope Class, records an event lasting as long as the scope
+    class TraceScope
+    {
+    public:
+        /**
+         * Start the event.
+         * \param name Name of the event, must outlive the trace
+         * \param detail Text shown with the event, must outlive the scope, or nullptr
+         */
+        TraceScope(const char *name, const char *detail = nullptr);
+
+        ~TraceScope();
+
+        TraceScope(const TraceScope &) = delete;
+        TraceScope &operator=(const TraceScope &) = delete;
+
+    private:
+        const char *name;
+        const char *detail;
+        int64_t begin;
+    };
+
+    /**
+     * Write the recorded events as Chrome trace-event JSON, loadable in Perfetto, and clear them.
+     * No thread may be recording while the trace is written.
+     * \param file Path to the output file
+     * \return Whether the file was written
+     */
+    bool writeTrace(const std::string &file);
+}
+
+#endif
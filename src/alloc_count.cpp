@@ -0,0 +1,172 @@
+#include <bmsparser/memory.hpp>
+#include <algorithm>
+#include <new>
+#include <cstddef>
+#include <cstdlib>
+
+// Replacements of every global operator new and delete, compiled into a program
+// only by the BMSPARSER_COUNT_ALLOCATIONS option. Each block carries its size
+// just before the pointer, in a header as large as its alignment.
+
+static void *allocate(std::size_t size, std::size_t align);
+static void *allocate_nothrow(std::size_t size, std::size_t align) noexcept;
+static void release(void *pointer, std::size_t align) noexcept;
+
+void *operator new(std::size_t size)
+{
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void *operator new[](std::size_t size)
+{
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate_nothrow(size, alignof(std::max_align_t));
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate_nothrow(size, alignof(std::max_align_t));
+}
+
+void *operator new(std::size_t size, std::align_val_t align)
+{
+    return allocate(size, (std::size_t)align);
+}
+
+void *operator new[](std::size_t size, std::align_val_t align)
+{
+    return allocate(size, (std::size_t)align);
+}
+
+void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return allocate_nothrow(size, (std::size_t)align);
+}
+
+void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return allocate_nothrow(size, (std::size_t)align);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    release(pointer, alignof(std::max_align_t));
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    release(pointer, alignof(std::max_align_t));
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    release(pointer, alignof(std::max_align_t));
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+    release(pointer, alignof(std::max_align_t));
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept
+{
+    release(pointer, alignof(std::max_align_t));
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept
+{
+    release(pointer, alignof(std::max_align_t));
+}
+
+void operator delete(void *pointer, std::align_val_t align) noexcept
+{
+    release(pointer, (std::size_t)align);
+}
+
+void operator delete[](void *pointer, std::align_val_t align) noexcept
+{
+    release(pointer, (std::size_t)align);
+}
+
+void operator delete(void *pointer, std::size_t, std::align_val_t align) noexcept
+{
+    release(pointer, (std::size_t)align);
+}
+
+void operator delete[](void *pointer, std::size_t, std::align_val_t align) noexcept
+{
+    release(pointer, (std::size_t)align);
+}
+
+void operator delete(void *pointer, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    release(pointer, (std::size_t)align);
+}
+
+void operator delete[](void *pointer, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    release(pointer, (std::size_t)align);
+}
+
+/// Bytes in front of a block of an alignment, enough for the size and keeping the alignment.
+static std::size_t header_of(std::size_t align)
+{
+    return std::max(align, alignof(std::max_align_t));
+}
+
+/// Allocate like the standard operator new: retry through the new handler, then throw.
+static void *allocate(std::size_t size, std::size_t align)
+{
+    std::size_t header = header_of(align);
+    while (true)
+    {
+        void *block;
+        if (align <= alignof(std::max_align_t))
+        {
+            block = std::malloc(header + size);
+        }
+        else
+        {
+            // aligned_alloc wants a multiple of the alignment.
+            block = std::aligned_alloc(align, (header + size + align - 1) & ~(align - 1));
+        }
+        if (block)
+        {
+            char *pointer = (char *)block + header;
+            *((std::size_t *)pointer - 1) = size;
+            bms::countAllocation(size);
+            return pointer;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+        {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+static void *allocate_nothrow(std::size_t size, std::size_t align) noexcept
+{
+    try
+    {
+        return allocate(size, align);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+static void release(void *pointer, std::size_t align) noexcept
+{
+    if (pointer)
+    {
+        bms::countDeallocation(*((std::size_t *)pointer - 1));
+        std::free((char *)pointer - header_of(align));
+    }
+}
@@ -0,0 +1,171 @@
+#include <bmsparser/analysis.hpp>
+#include <algorithm>
+#include <bitset>
+
+using namespace bms;
+
+/// Scratch lane of both players
+static const uint32_t SCRATCH_MASK = 1u << 5 | 1u << 14;
+
+/// Scratch and keys 1~3 of player 1
+static const uint32_t SINGLE_LEFT_MASK = 1u << 0 | 1u << 1 | 1u << 2 | 1u << 5;
+
+/// Every lane of player 1
+static const uint32_t DUAL_LEFT_MASK = 0x1ff;
+
+static std::vector<float> note_times(const Chart &chart);
+static int popcount(uint32_t mask);
+
+Density bms::analyzeDensity(const Chart &chart, float window, size_t points)
+{
+    Density density;
+    density.peak = 0;
+    density.peakTime = 0;
+    density.average = 0;
+    density.curve.assign(points, 0);
+
+    // A window that is not positive never closes, so it is rejected like a chart without notes.
+    if (!(window > 0))
+    {
+        return density;
+    }
+
+    std::vector<float> times = note_times(chart);
+    if (times.empty())
+    {
+        return density;
+    }
+
+    float length = std::max(chart.stats.length, times.back());
+
+    density.perSecond.assign((size_t)length + 1, 0);
+    for (float time : times)
+    {
+        density.perSecond[(size_t)std::max(time, 0.0f)]++;
+    }
+    for (int count : density.perSecond)
+    {
+        if ((size_t)count >= density.distribution.size())
+        {
+            density.distribution.resize(count + 1, 0);
+        }
+        density.distribution[count]++;
+    }
+
+    // Notes are in position order, so measures only ever move forward.
+    size_t measure = 0;
+    for (const Obj &obj : chart.objs)
+    {
+        if (obj.type != Obj::Type::NOTE || obj.note.end)
+        {
+            continue;
+        }
+        while (measure + 1 < (size_t)chart.measures && obj.pos >= chart.measureStarts[measure + 1])
+        {
+            measure++;
+        }
+        if (measure >= density.perMeasure.size())
+        {
+            density.perMeasure.resize(measure + 1, 0);
+        }
+        density.perMeasure[measure]++;
+    }
+
+    size_t begin = 0;
+    for (size_t end = 0; end < times.size(); end++)
+    {
+        while (times[end] - times[begin] >= window)
+        {
+            begin++;
+        }
+        if (end - begin + 1 > density.peak * window)
+        {
+            density.peak = (end - begin + 1) / window;
+            density.peakTime = times[begin];
+        }
+    }
+
+    density.average = length > 0 ? times.size() / length : 0;
+
+    size_t next = 0;
+    float slice = length / points;
+    for (size_t i = 0; i < points && slice > 0; i++)
+    {
+        float sliceEnd = i + 1 == points ? length : slice * (i + 1);
+        size_t first = next;
+        while (next < times.size() && (times[next] < sliceEnd || i + 1 == points))
+        {
+            next++;
+        }
+        density.curve[i] = (next - first) / slice;
+    }
+
+    return density;
+}
+
+std::vector<ChordRow> bms::chordRows(const Chart &chart)
+{
+    std::vector<ChordRow> rows;
+    for (const Obj &obj : chart.objs)
+    {
+        if (obj.type != Obj::Type::NOTE || obj.note.end)
+        {
+            continue;
+        }
+        if (rows.empty() || rows.back().time != obj.time)
+        {
+            rows.push_back(ChordRow{obj.time, 0});
+        }
+        rows.back().mask |= 1u << ((obj.note.player - 1) * 9 + obj.note.line - 1);
+    }
+    return rows;
+}
+
+PatternStats bms::analyzePatterns(const Chart &chart)
+{
+    std::vector<ChordRow> rows = chordRows(chart);
+
+    PatternStats stats = PatternStats{(int)rows.size(), 0, 0, 0, std::vector<int>(19, 0), 0, 0, 0, 0, 0, 0};
+    uint32_t left = chart.type == Chart::Type::Single ? SINGLE_LEFT_MASK : DUAL_LEFT_MASK;
+
+    uint32_t previous = 0, before = 0;
+    for (const ChordRow &row : rows)
+    {
+        uint32_t repeated = row.mask & previous;
+        stats.jacks += popcount(repeated);
+        stats.jackRows += repeated != 0;
+        stats.trillRows += row.mask == before && previous != 0 && repeated == 0;
+        stats.chordSizes[popcount(row.mask)]++;
+        stats.scratchRows += (row.mask & SCRATCH_MASK) != 0;
+        bool hasLeft = (row.mask & left) != 0, hasRight = (row.mask & ~left) != 0;
+        stats.leftRows += hasLeft && !hasRight;
+        stats.rightRows += hasRight && !hasLeft;
+        stats.bothRows += hasLeft && hasRight;
+        before = previous;
+        previous = row.mask;
+    }
+
+    stats.scratchDensity = chart.stats.length > 0 ? stats.scratchRows / chart.stats.length : 0;
+    stats.longNoteRatio = chart.stats.notes > 0 ? (float)chart.stats.longNotes / chart.stats.notes : 0;
+
+    return stats;
+}
+
+static std::vector<float> note_times(const Chart &chart)
+{
+    std::vector<float> times;
+    times.reserve(chart.stats.notes);
+    for (const Obj &obj : chart.objs)
+    {
+        if (obj.type == Obj::Type::NOTE && !obj.note.end)
+        {
+            times.push_back(obj.time);
+        }
+    }
+    return times;
+}
+
+static int popcount(uint32_t mask)
+{
+    return (int)std::bitset<32>(mask).count();
+}
@@ -0,0 +1,62 @@
+#include <bmsparser/audio.hpp>
+#include <algorithm>
+
+using namespace bms;
+
+AudioStream::AudioStream(const Chart &chart, int sampleRate)
+{
+    this->sampleRate = sampleRate;
+    for (const Obj &obj : chart.objs)
+    {
+        int key;
+        if (obj.type == Obj::Type::BGM)
+            key = obj.bgm.key;
+        else if (obj.type == Obj::Type::NOTE && !obj.note.end)
+            key = obj.note.key;
+        else
+            continue;
+        this->events.push_back(AudioEvent{(obj.timeNs * sampleRate + 500000000) / 1000000000, key, obj.type});
+    }
+}
+
+AudioCursor::AudioCursor(const AudioStream &stream) : stream(stream), next(0), playhead(0), target(INT64_MIN)
+{
+}
+
+void AudioCursor::seek(int64_t sample)
+{
+    this->target.store(sample, std::memory_order_release);
+}
+
+size_t AudioCursor::read(uint32_t frames, AudioTrigger *triggers, size_t capacity)
+{
+    const std::vector<AudioEvent> &events = this->stream.events;
+
+    int64_t start = this->target.exchange(INT64_MIN, std::memory_order_acquire);
+    if (start != INT64_MIN)
+    {
+        this->next = std::lower_bound(events.begin(), events.end(), start, [](const AudioEvent &event, int64_t sample)
+                                      { return event.sample < sample; }) -
+                     events.begin();
+    }
+    else
+    {
+        start = this->playhead.load(std::memory_order_relaxed);
+    }
+    int64_t end = start + frames;
+
+    size_t count = 0;
+    while (count < capacity && this->next < events.size() && events[this->next].sample < end)
+    {
+        const AudioEvent &event = events[this->next++];
+        triggers[count++] = AudioTrigger{(uint32_t)std::max<int64_t>(event.sample - start, 0), event.key, event.source};
+    }
+
+    this->playhead.store(end, std::memory_order_relaxed);
+    return count;
+}
+
+int64_t AudioCursor::position() const
+{
+    return this->playhead.load(std::memory_order_relaxed);
+}
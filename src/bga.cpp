@@ -0,0 +1,50 @@
+#include <bmsparser/bga.hpp>
+#include <algorithm>
+
+using namespace bms;
+
+BgaCursor::BgaCursor(const Chart &chart) : chart(chart)
+{
+    this->time = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        this->passed[i] = 0;
+    }
+    this->seek(0);
+}
+
+void BgaCursor::update(float time)
+{
+    if (time < this->time)
+    {
+        this->seek(time);
+        return;
+    }
+    this->time = time;
+    for (int i = 0; i < 3; i++)
+    {
+        const std::vector<BgaEvent> &events = this->chart.bgas[i];
+        while (this->passed[i] < events.size() && events[this->passed[i]].time <= time)
+        {
+            this->passed[i]++;
+        }
+    }
+}
+
+void BgaCursor::seek(float time)
+{
+    this->time = time;
+    for (int i = 0; i < 3; i++)
+    {
+        const std::vector<BgaEvent> &events = this->chart.bgas[i];
+        this->passed[i] = std::upper_bound(events.begin(), events.end(), time, [](float t, const BgaEvent &e)
+                                           { return t < e.time; }) -
+                          events.begin();
+    }
+}
+
+int BgaCursor::key(int layer) const
+{
+    size_t passed = this->passed[layer + 1];
+    return passed ? this->chart.bgas[layer + 1][passed - 1].key : 0;
+}
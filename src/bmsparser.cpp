@@ -1,19 +1,154 @@
 #include <bmsparser.hpp>
+#include <bmsparser/trace.hpp>
 #include <fstream>
-#include <sstream>
 #include <stack>
 #include <map>
+#include <memory>
 #include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <charconv>
+#include <chrono>
+#include <stdexcept>
 
 using namespace bms;
 
-static bool file_check(const std::string &file);
+/**
+ * Stable sort by fraction, for items made of sorted runs.
+ * Each channel line appends one run, so the runs are bucketed by measure
+ * in file order and the few runs of each measure are merged with a heap.
+ * Ties go to the earlier run, which matches std::stable_sort.
+ */
+template <typename T>
+static void merge_runs(std::vector<T> &items, const std::vector<size_t> &runs, int lastMeasure)
+{
+    std::vector<size_t> starts, ends;
+    for (size_t i = 0; i < runs.size(); i++)
+    {
+        size_t end = i + 1 < runs.size() ? runs[i + 1] : items.size();
+        if (runs[i] < end)
+        {
+            starts.push_back(runs[i]);
+            ends.push_back(end);
+        }
+    }
+
+    std::vector<size_t> buckets(lastMeasure + 2, 0);
+    for (size_t start : starts)
+    {
+        buckets[items[start].fraction.measure + 1]++;
+    }
+    for (int measure = 0; measure <= lastMeasure; measure++)
+    {
+        buckets[measure + 1] += buckets[measure];
+    }
+    std::vector<size_t> order(starts.size());
+    for (size_t i = 0; i < starts.size(); i++)
+    {
+        order[buckets[items[starts[i]].fraction.measure]++] = i;
+    }
+
+    std::vector<T> sorted;
+    sorted.reserve(items.size());
+    std::vector<size_t> heads(starts.size()), heap;
+    for (size_t first = 0; first < order.size();)
+    {
+        size_t last = first + 1;
+        while (last < order.size() && items[starts[order[last]]].fraction.measure == items[starts[order[first]]].fraction.measure)
+        {
+            last++;
+        }
+
+        if (last - first == 1)
+        {
+            sorted.insert(sorted.end(), items.begin() + starts[order[first]], items.begin() + ends[order[first]]);
+        }
+        else
+        {
+            // Heap of positions in order, whose heads are the next item of each run.
+            auto later = [&](size_t a, size_t b)
+            {
+                const T &x = items[heads[order[a]]], &y = items[heads[order[b]]];
+                return y.fraction < x.fraction || (!(x.fraction < y.fraction) && a > b);
+            };
+            heap.clear();
+            for (size_t i = first; i < last; i++)
+            {
+                heads[order[i]] = starts[order[i]];
+                heap.push_back(i);
+            }
+            std::make_heap(heap.begin(), heap.end(), later);
+            while (!heap.empty())
+            {
+                std::pop_heap(heap.begin(), heap.end(), later);
+                size_t run = order[heap.back()];
+                sorted.push_back(items[heads[run]++]);
+                if (heads[run] < ends[run])
+                {
+                    std::push_heap(heap.begin(), heap.end(), later);
+                }
+                else
+                {
+                    heap.pop_back();
+                }
+            }
+        }
+        first = last;
+    }
+
+    items.swap(sorted);
+}
 
-static Obj create_bgm(float fraction, int key);
-static Obj create_bmp(float fraction, int key, int layer);
-static Obj create_note(float fraction, int player, int line, int key, bool end);
-static Obj create_inv(float fraction, int player, int line, int key);
-static Obj create_bomb(float fraction, int player, int line, int damage);
+static size_t find_sector(const std::vector<Sector> &sectors, const std::vector<double> &sectorPos, size_t &below, double pos);
+
+bool Fraction::operator<(const Fraction &other) const
+{
+    if (this->measure != other.measure)
+    {
+        return this->measure < other.measure;
+    }
+    return (int64_t)this->num * other.den < (int64_t)other.num * this->den;
+}
+
+bool Fraction::operator==(const Fraction &other) const
+{
+    return this->measure == other.measure && this->num == other.num && this->den == other.den;
+}
+
+/**
+ * Find the sector Chart::pos2time would use, for positions in ascending order.
+ * below counts the sectors strictly before the previous position and is advanced in place.
+ */
+static size_t find_sector(const std::vector<Sector> &sectors, const std::vector<double> &sectorPos, size_t &below, double pos)
+{
+    while (below < sectors.size() && sectorPos[below] < pos)
+    {
+        below++;
+    }
+    size_t sector = below > 0 ? below - 1 : 0;
+    for (size_t i = below; i < sectors.size() && sectorPos[i] == pos; i++)
+    {
+        if (sectors[i].inclusive)
+        {
+            sector = i;
+        }
+    }
+    return sector;
+}
+
+static Obj create_bgm(const Fraction &fraction, int key);
+static Obj create_bmp(const Fraction &fraction, int key, int layer);
+static Obj create_note(const Fraction &fraction, int player, int line, int key, bool end);
+static Obj create_inv(const Fraction &fraction, int player, int line, int key);
+static Obj create_bomb(const Fraction &fraction, int player, int line, int damage);
+
+static Chart *parse(const std::string &file, const std::vector<int> &randoms, std::vector<Diagnostic> *diagnostics, ParseStats *parseStats);
+template <typename T>
+static std::errc read_number(const char *first, const char *last, int base, T &value);
+static std::errc read_float(const char *first, const char *last, float &value);
+static const char *skip_sign(const char *first, const char *last);
 
 Chart::Chart()
 {
@@ -29,13 +164,11 @@ Chart::Chart()
     this->difficulty = 2;
     this->total = 160;
     this->rank = 2;
+    this->stats = ChartStats{0, 0, 0, 0, 130, 130, 130, 0};
     this->wavs = new std::string[1296];
     this->bmps = new std::string[1296];
-    this->signatures = new float[1000];
-    for (int i = 0; i < 1000; i++)
-    {
-        this->signatures[i] = 1;
-    }
+    this->measures = 0;
+    this->measureStarts.push_back(0);
     this->sectors.push_back(Sector(0, 0, 130, true));
 }
 
@@ -53,6 +186,9 @@ Chart::Chart(const Chart &chart)
     this->difficulty = chart.difficulty;
     this->total = chart.total;
     this->rank = chart.rank;
+    this->stats = chart.stats;
+    this->randoms = chart.randoms;
+    this->barLines = chart.barLines;
     this->wavs = new std::string[1296];
     this->bmps = new std::string[1296];
     for (int i = 0; i < 1296; i++)
@@ -60,25 +196,114 @@ Chart::Chart(const Chart &chart)
         this->wavs[i] = chart.wavs[i];
         this->bmps[i] = chart.bmps[i];
     }
-    this->signatures = new float[1000];
-    for (int i = 0; i < 1000; i++)
-    {
-        this->signatures[i] = chart.signatures[i];
-    }
+    this->signatures = chart.signatures;
+    this->measures = chart.measures;
+    this->measureStarts = chart.measureStarts;
     this->objs.assign(chart.objs.begin(), chart.objs.end());
     this->sectors.assign(chart.sectors.begin(), chart.sectors.end());
+    for (int i = 0; i < 3; i++)
+    {
+        this->bgas[i].assign(chart.bgas[i].begin(), chart.bgas[i].end());
+    }
+    this->bmpOrder.assign(chart.bmpOrder.begin(), chart.bmpOrder.end());
 }
 
 Chart::~Chart()
 {
     delete[] this->wavs;
     delete[] this->bmps;
-    delete[] this->signatures;
 }
 
 Chart *bms::parseBMS(const std::string &file)
 {
-    Chart *chart = new Chart;
+    return parseBMS(file, std::vector<int>());
+}
+
+Chart *bms::parseBMS(const std::string &file, const std::vector<int> &randoms)
+{
+    return parse(file, randoms, nullptr, nullptr);
+}
+
+Chart *bms::parseBMS(const std::string &file, const std::vector<int> &randoms, ParseStats *stats)
+{
+    return parse(file, randoms, nullptr, stats);
+}
+
+ParseResult bms::tryParseBMS(const std::string &file)
+{
+    return tryParseBMS(file, std::vector<int>());
+}
+
+ParseResult bms::tryParseBMS(const std::string &file, const std::vector<int> &randoms)
+{
+    ParseResult result;
+    result.chart = parse(file, randoms, &result.diagnostics, nullptr);
+    return result;
+}
+
+/**
+ * Parse a chart.
+ * Without diagnostics, a malformed number throws as std::stoi would;
+ * with them, it is recorded and its token or line is skipped.
+ * The clock is only read when parseStats is given.
+ */
+static Chart *parse(const std::string &file, const std::vector<int> &randoms, std::vector<Diagnostic> *diagnostics, ParseStats *parseStats)
+{
+    std::chrono::steady_clock::time_point mark;
+    if (parseStats)
+    {
+        *parseStats = ParseStats{};
+        mark = std::chrono::steady_clock::now();
+    }
+    // Adds the time since the previous phase ended to a phase.
+    auto phase = [&](int64_t &duration)
+    {
+        if (parseStats)
+        {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            duration += std::chrono::duration_cast<std::chrono::nanoseconds>(now - mark).count();
+            mark = now;
+        }
+    };
+
+#ifdef BMSPARSER_TRACE
+    TraceScope traceParse("parseBMS", file.c_str());
+    int64_t traceMark = traceClock();
+    // Ends a traced phase; lines are traced as one phase, since tokenizing and decoding alternate per line.
+    auto trace = [&](const char *name)
+    {
+        int64_t now = traceClock();
+        traceEvent(name, traceMark, now);
+        traceMark = now;
+    };
+#else
+    auto trace = [](const char *) {};
+#endif
+
+    std::ifstream input(file, std::ios::binary);
+    if (!input)
+    {
+        if (!diagnostics)
+        {
+            throw std::invalid_argument("Cannot read the file");
+        }
+        diagnostics->push_back(Diagnostic{0, 0, Diagnostic::Kind::FILE});
+        return nullptr;
+    }
+
+    // The whole file is read up front, so that reading and tokenizing can be timed apart.
+    std::string text;
+    char buffer[65536];
+    while (input.read(buffer, sizeof(buffer)), input.gcount() > 0)
+    {
+        text.append(buffer, (size_t)input.gcount());
+    }
+    input.close();
+    int64_t readNs = 0, tokenizeNs = 0, decodeNs = 0, sortNs = 0, sectorsNs = 0, timingNs = 0;
+    phase(readNs);
+    trace("read");
+
+    std::unique_ptr<Chart> chart(new Chart);
 
     chart->filename = file;
 
@@ -86,11 +311,10 @@ Chart *bms::parseBMS(const std::string &file)
 
     std::vector<int> lnobj;
     std::map<int, bool> ln;
-    float *bpms = new float[1296];
-    float *stops = new float[1296];
+    std::vector<float> bpms(1296, 0), stops(1296, 0);
     struct speedcore_t
     {
-        float fraction;
+        Fraction fraction;
         enum class Type
         {
             BPM,
@@ -99,17 +323,45 @@ Chart *bms::parseBMS(const std::string &file)
         float value;
     };
     std::vector<speedcore_t> speedcore;
-    int random;
+    std::vector<size_t> objRuns, speedcoreRuns;
+    int lastMeasure = 0;
+    std::map<int, float> signatures;
+    int random = 0;
     std::stack<bool> skip;
     skip.push(false);
 
     srand((unsigned int)time(NULL));
 
-    std::ifstream input(file);
     std::string line;
+    int lineNumber = 0;
+
+    // Reports a failed read at a 0-based column of content, and tells whether the value can be used.
+    auto check = [&](std::errc error, size_t column)
+    {
+        if (error == std::errc())
+        {
+            return true;
+        }
+        Diagnostic::Kind kind = error == std::errc::result_out_of_range ? Diagnostic::Kind::RANGE : Diagnostic::Kind::NUMBER;
+        if (!diagnostics)
+        {
+            if (kind == Diagnostic::Kind::RANGE)
+            {
+                throw std::out_of_range("Number out of range");
+            }
+            throw std::invalid_argument("Malformed number");
+        }
+        diagnostics->push_back(Diagnostic{lineNumber, (int)column + 2, kind});
+        return false;
+    };
 
-    while (std::getline(input, line))
+    int channelLines = 0, skippedLines = 0, commandLines = 0;
+    for (size_t lineBegin = 0; lineBegin < text.length();)
     {
+        size_t lineEnd = std::min(text.find('\n', lineBegin), text.length());
+        line.assign(text, lineBegin, lineEnd - lineBegin);
+        lineBegin = lineEnd + 1;
+        lineNumber++;
         line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
 
         if (line.empty() || line[0] != '#')
@@ -117,20 +369,63 @@ Chart *bms::parseBMS(const std::string &file)
             continue;
         }
 
+        commandLines++;
         std::string content = line.substr(1);
-        std::string header;
-        std::string data;
-        std::getline(std::stringstream(content) >> header >> std::ws, data);
+        size_t headerBegin = 0;
+        while (headerBegin < content.length() && std::isspace((unsigned char)content[headerBegin]))
+        {
+            headerBegin++;
+        }
+        size_t headerEnd = headerBegin;
+        while (headerEnd < content.length() && !std::isspace((unsigned char)content[headerEnd]))
+        {
+            headerEnd++;
+        }
+        size_t dataBegin = headerEnd;
+        while (dataBegin < content.length() && std::isspace((unsigned char)content[dataBegin]))
+        {
+            dataBegin++;
+        }
+        std::string header = content.substr(headerBegin, headerEnd - headerBegin);
+        std::string data = content.substr(dataBegin);
+        const char *dataFirst = content.data() + dataBegin, *dataLast = content.data() + content.length();
 
         std::transform(header.begin(), header.end(), header.begin(), ::toupper);
 
         if (header == "RANDOM")
         {
-            random = rand() % std::stoi(data) + 1;
+            int range;
+            std::errc error = read_number(dataFirst, dataLast, 10, range);
+            if (error == std::errc() && range < 1)
+            {
+                error = std::errc::result_out_of_range;
+            }
+            if (check(error, dataBegin))
+            {
+                if (chart->randoms.size() < randoms.size())
+                {
+                    random = std::min(std::max(randoms[chart->randoms.size()], 1), range);
+                }
+                else
+                {
+                    random = rand() % range + 1;
+                }
+                chart->randoms.push_back(random);
+            }
         }
         else if (header == "IF")
         {
-            skip.push(random != std::stoi(data));
+            int value;
+            // An unreadable condition never holds, so the block is still closed by its #ENDIF.
+            skip.push(!check(read_number(dataFirst, dataLast, 10, value), dataBegin) || random != value);
+        }
+        else if ((header == "ELSE" || header == "ENDIF") && skip.size() == 1)
+        {
+            if (diagnostics)
+            {
+                diagnostics->push_back(Diagnostic{lineNumber, (int)headerBegin + 2, Diagnostic::Kind::UNMATCHED});
+            }
+            continue;
         }
         else if (header == "ELSE")
         {
@@ -145,6 +440,11 @@ Chart *bms::parseBMS(const std::string &file)
 
         if (skip.top())
         {
+            // Block directives are header lines whichever branch they open or close.
+            if (header != "RANDOM" && header != "IF" && header != "ELSE" && header != "ENDIF")
+            {
+                skippedLines++;
+            }
             continue;
         }
 
@@ -196,78 +496,144 @@ Chart *bms::parseBMS(const std::string &file)
         }
         else if (header == "PLAYLEVEL")
         {
-            chart->playLevel = std::stoi(data);
+            int value;
+            if (check(read_number(dataFirst, dataLast, 10, value), dataBegin))
+            {
+                chart->playLevel = value;
+            }
         }
         else if (header == "DIFFICULTY")
         {
-            chart->difficulty = std::stoi(data);
+            int value;
+            if (check(read_number(dataFirst, dataLast, 10, value), dataBegin))
+            {
+                chart->difficulty = value;
+            }
         }
         else if (header == "TOTAL")
         {
-            chart->total = std::stof(data);
+            float value;
+            if (check(read_float(dataFirst, dataLast, value), dataBegin))
+            {
+                chart->total = value;
+            }
         }
         else if (header == "RANK")
         {
-            chart->rank = std::stoi(data);
+            int value;
+            if (check(read_number(dataFirst, dataLast, 10, value), dataBegin))
+            {
+                chart->rank = value;
+            }
         }
         else if (header.length() == 5 && header.substr(0, 3) == "WAV")
         {
-            int key = std::stoi(header.substr(3, 2), nullptr, 36);
-            chart->wavs[key] = parent + data;
+            unsigned int key;
+            if (check(read_number(header.data() + 3, header.data() + 5, 36, key), headerBegin + 3))
+            {
+                chart->wavs[key] = parent + data;
+            }
         }
         else if (header.length() == 5 && header.substr(0, 3) == "BMP")
         {
-            int key = std::stoi(header.substr(3, 2), nullptr, 36);
-            chart->bmps[key] = parent + data;
+            unsigned int key;
+            if (check(read_number(header.data() + 3, header.data() + 5, 36, key), headerBegin + 3))
+            {
+                chart->bmps[key] = parent + data;
+            }
         }
         else if (header == "LNOBJ")
         {
-            lnobj.push_back(std::stoi(data, nullptr, 36));
+            int key;
+            if (check(read_number(dataFirst, dataLast, 36, key), dataBegin))
+            {
+                lnobj.push_back(key);
+            }
         }
         else if (header == "BPM")
         {
-            chart->sectors[0].bpm = std::stof(data);
+            float value;
+            if (check(read_float(dataFirst, dataLast, value), dataBegin))
+            {
+                chart->sectors[0].bpm = value;
+            }
         }
         else if (header.length() == 5 && header.substr(0, 3) == "BPM")
         {
-            int key = std::stoi(header.substr(3, 2), nullptr, 36);
-            bpms[key] = std::stof(data);
+            unsigned int key;
+            float value;
+            if (check(read_number(header.data() + 3, header.data() + 5, 36, key), headerBegin + 3) && check(read_float(dataFirst, dataLast, value), dataBegin))
+            {
+                bpms[key] = value;
+            }
         }
         else if (header.length() == 6 && header.substr(0, 4) == "STOP")
         {
-            int key = std::stoi(header.substr(4, 2), nullptr, 36);
-            stops[key] = std::stoi(data) / 192.0f;
+            unsigned int key;
+            int value;
+            if (check(read_number(header.data() + 4, header.data() + 6, 36, key), headerBegin + 4) && check(read_number(dataFirst, dataLast, 10, value), dataBegin))
+            {
+                stops[key] = value / 192.0f;
+            }
         }
-        else if (content[5] == ':')
+        else if (content.length() > 5 && content[5] == ':')
         {
-            int measure = std::stoi(content.substr(0, 3));
+            channelLines++;
+            unsigned int measure;
+            if (!check(read_number(content.data(), content.data() + 3, 10, measure), 0))
+            {
+                continue;
+            }
+            lastMeasure = std::max(lastMeasure, (int)measure);
             if (content.substr(3, 2) == "02")
             {
-                chart->signatures[measure] = std::stof(content.substr(6));
+                float value;
+                if (check(read_float(content.data() + 6, content.data() + content.length(), value), 6))
+                {
+                    signatures[measure] = value;
+                }
             }
             else
             {
-                int channel = std::stoi(content.substr(3, 2), nullptr, 36);
-                std::string objs = content.substr(6);
-                unsigned long long l = objs.length() / 2;
+                unsigned int channel;
+                if (!check(read_number(content.data() + 3, content.data() + 5, 36, channel), 3))
+                {
+                    continue;
+                }
+                phase(tokenizeNs);
+                const char *objs = content.data() + 6;
+                unsigned long long l = (content.length() - 6) / 2;
+                objRuns.push_back(chart->objs.size());
+                speedcoreRuns.push_back(speedcore.size());
                 for (unsigned long long i = 0; i < l; i++)
                 {
-                    int key = std::stoi(objs.substr(i * 2, 2), nullptr, 36);
+                    unsigned int key;
+                    if (!check(read_number(objs + i * 2, objs + i * 2 + 2, 36, key), 6 + i * 2))
+                    {
+                        continue;
+                    }
                     if (key)
                     {
-                        float fraction = measure + (float)i / l;
+                        int divisor = std::gcd((int)i, (int)l);
+                        Fraction fraction{(int)measure, (int)i / divisor, (int)l / divisor};
                         switch (channel)
                         {
                         case 1: // 01
                             chart->objs.push_back(create_bgm(fraction, key));
                             break;
                         case 3: // 03
-                            speedcore.push_back(speedcore_t{
-                                fraction,
-                                speedcore_t::Type::BPM,
-                                (float)std::stoi(objs.substr(i * 2, 2), nullptr, 16),
-                            });
+                        {
+                            int bpm;
+                            if (check(read_number(objs + i * 2, objs + i * 2 + 2, 16, bpm), 6 + i * 2))
+                            {
+                                speedcore.push_back(speedcore_t{
+                                    fraction,
+                                    speedcore_t::Type::BPM,
+                                    (float)bpm,
+                                });
+                            }
                             break;
+                        }
                         case 4: // 04
                             chart->objs.push_back(create_bmp(fraction, key, 0));
                             break;
@@ -387,59 +753,165 @@ Chart *bms::parseBMS(const std::string &file)
                         }
                     }
                 }
+                phase(decodeNs);
             }
         }
     }
+    phase(tokenizeNs);
+    trace("lines");
 
-    input.close();
+    merge_runs(speedcore, speedcoreRuns, lastMeasure);
+    phase(sortNs);
+    trace("sort");
 
-    std::stable_sort(speedcore.begin(), speedcore.end(), [](const speedcore_t &a, const speedcore_t &b)
-                     { return a.fraction < b.fraction; });
+    std::vector<float> lengths(lastMeasure + 1, 1);
+    for (const std::pair<const int, float> &signature : signatures)
+    {
+        lengths[signature.first] = signature.second;
+        if (signature.second != 1)
+        {
+            chart->signatures.push_back(signature);
+        }
+    }
+
+    // Positions and times are carried in double precision and only rounded when stored.
+    std::vector<double> measureStart(lastMeasure + 2, 0);
+    for (int measure = 0; measure <= lastMeasure; measure++)
+    {
+        measureStart[measure + 1] = measureStart[measure] + lengths[measure];
+    }
+    chart->measures = lastMeasure + 1;
+    chart->measureStarts.assign(measureStart.begin(), measureStart.end());
+    auto exact_pos = [&](const Fraction &fraction)
+    {
+        return measureStart[fraction.measure] + (double)fraction.num / fraction.den * lengths[fraction.measure];
+    };
+    std::vector<double> sectorPos(1, 0), sectorTime(1, 0);
+
+    std::map<float, float> bpmTimes;
     for (speedcore_t &core : speedcore)
     {
-        const Sector &last = chart->sectors.back();
-        float pos = chart->frac2pos(core.fraction);
-        float time = last.pos2time(pos);
+        const Sector last = chart->sectors.back();
+        double pos = exact_pos(core.fraction);
+        double time = sectorTime.back() + (last.bpm > 0 ? (pos - sectorPos.back()) * 240 / last.bpm : 0);
+        if (last.bpm > 0)
+        {
+            bpmTimes[last.bpm] += (float)(time - sectorTime.back());
+        }
         switch (core.type)
         {
         case speedcore_t::Type::BPM:
-            chart->sectors.push_back(Sector(pos, time, core.value, true));
+            chart->sectors.push_back(Sector((float)pos, (float)time, core.value, true));
+            sectorPos.push_back(pos);
+            sectorTime.push_back(time);
             break;
         case speedcore_t::Type::STP:
-            chart->sectors.push_back(Sector(pos, time, 0, true));
-            chart->sectors.push_back(Sector(pos, time + last.pos2time(core.value + last.pos) - last.time, last.bpm, false));
+            chart->sectors.push_back(Sector((float)pos, (float)time, 0, true));
+            sectorPos.push_back(pos);
+            sectorTime.push_back(time);
+            time += last.bpm > 0 ? core.value * 240.0 / last.bpm : 0;
+            chart->sectors.push_back(Sector((float)pos, (float)time, last.bpm, false));
+            sectorPos.push_back(pos);
+            sectorTime.push_back(time);
             break;
         }
     }
-    std::stable_sort(chart->objs.begin(), chart->objs.end(), [](const Obj &a, const Obj &b)
-                     { return a.pos < b.pos; });
-    for (Obj &note : chart->objs)
-    {
-        note.pos = chart->frac2pos(note.pos);
-        note.time = chart->pos2time(note.pos);
-    }
-
-    delete[] bpms;
-    delete[] stops;
-
+    phase(sectorsNs);
+    trace("sectors");
+    merge_runs(chart->objs, objRuns, lastMeasure);
+    phase(sortNs);
+    trace("sort");
+    std::vector<bool> shown(1296, false);
     bool p2 = false;
-    for (const Obj &obj : chart->objs)
+    ChartStats &stats = chart->stats;
+    size_t below = 0;
+    for (Obj &note : chart->objs)
     {
-        switch (obj.type)
+        double pos = exact_pos(note.fraction);
+        size_t sector = find_sector(chart->sectors, sectorPos, below, pos);
+        double time = sectorTime[sector] + (chart->sectors[sector].bpm > 0 ? (pos - sectorPos[sector]) * 240 / chart->sectors[sector].bpm : 0);
+        note.pos = (float)pos;
+        note.time = (float)time;
+        note.timeNs = std::llround(time * 1e9);
+        switch (note.type)
         {
+        case Obj::Type::BMP:
+            chart->bgas[note.bmp.layer + 1].push_back(BgaEvent{note.time, note.bmp.key});
+            if (!shown[note.bmp.key])
+            {
+                shown[note.bmp.key] = true;
+                chart->bmpOrder.push_back(note.bmp.key);
+            }
+            break;
         case Obj::Type::NOTE:
-            if (obj.note.player > 1)
+            if (note.note.end)
+            {
+                stats.longNotes++;
+            }
+            else
+            {
+                stats.notes++;
+                if (note.note.line == 6)
+                {
+                    stats.scratches++;
+                }
+            }
+            if (note.note.player > 1)
             {
                 p2 = true;
             }
             break;
-        case Obj::Type::INVISIBLE:
         case Obj::Type::BOMB:
-            if (obj.misc.player > 1)
+            stats.mines++;
+            [[fallthrough]];
+        case Obj::Type::INVISIBLE:
+            if (note.misc.player > 1)
             {
                 p2 = true;
             }
             break;
+        default:
+            break;
+        }
+    }
+
+    // Lines come in position order, so the sector is found by walking forward.
+    below = 0;
+    for (int measure = 0; measure <= lastMeasure + 1; measure++)
+    {
+        float length = measure <= lastMeasure ? lengths[measure] : 0;
+        for (float beat = 0; beat == 0 || beat < length; beat += 0.25f)
+        {
+            double pos = measureStart[measure] + beat;
+            size_t sector = find_sector(chart->sectors, sectorPos, below, pos);
+            double time = sectorTime[sector] + (chart->sectors[sector].bpm > 0 ? (pos - sectorPos[sector]) * 240 / chart->sectors[sector].bpm : 0);
+            chart->barLines.push_back(BarLine{(float)pos, (float)time, beat == 0});
+        }
+    }
+
+    stats.length = chart->objs.empty() ? 0 : chart->objs.back().time;
+    const Sector &last = chart->sectors.back();
+    if (last.bpm > 0 && stats.length > last.time)
+    {
+        bpmTimes[last.bpm] += stats.length - last.time;
+    }
+    stats.minBpm = stats.maxBpm = stats.mainBpm = chart->sectors[0].bpm;
+    float longest = 0;
+    for (const std::pair<const float, float> &bpmTime : bpmTimes)
+    {
+        if (bpmTime.second <= 0)
+        {
+            continue;
+        }
+        if (longest == 0)
+        {
+            stats.minBpm = bpmTime.first;
+        }
+        stats.maxBpm = bpmTime.first;
+        if (bpmTime.second > longest)
+        {
+            longest = bpmTime.second;
+            stats.mainBpm = bpmTime.first;
         }
     }
 
@@ -451,40 +923,65 @@ Chart *bms::parseBMS(const std::string &file)
     {
         chart->type = Chart::Type::Dual;
     }
+    phase(timingNs);
+    trace("timing");
+
+    if (parseStats)
+    {
+        parseStats->readNs = readNs;
+        parseStats->tokenizeNs = tokenizeNs;
+        parseStats->decodeNs = decodeNs;
+        parseStats->sortNs = sortNs;
+        parseStats->sectorsNs = sectorsNs;
+        parseStats->timingNs = timingNs;
+        parseStats->bytes = text.length();
+        parseStats->lines = lineNumber;
+        parseStats->channelLines = channelLines;
+        parseStats->headerLines = commandLines - channelLines - skippedLines;
+        parseStats->skippedLines = skippedLines;
+        for (const Obj &obj : chart->objs)
+        {
+            parseStats->objs[(int)obj.type]++;
+        }
+        parseStats->sectors = (int)chart->sectors.size();
+    }
 
-    return chart;
+    return chart.release();
 }
 
-static bool file_check(const std::string &file)
+float Chart::signature(int measure) const
 {
-    std::ifstream stream(file);
-    return stream.good();
+    const std::vector<std::pair<int, float>>::const_iterator &i = std::lower_bound(this->signatures.cbegin(), this->signatures.cend(), measure, [](const std::pair<int, float> &a, int measure)
+                                                                                   { return a.first < measure; });
+    return i != this->signatures.cend() && i->first == measure ? i->second : 1;
 }
 
 float Chart::frac2pos(float frac) const
 {
-    int measure = (int)frac;
-    float f = frac - measure;
-    float pos = f * this->signatures[measure];
-    for (int m = 0; m < measure; m++)
+    int measure = (int)std::floor(frac);
+    if (measure < 0)
     {
-        pos += this->signatures[m];
+        return frac;
     }
-    return pos;
+    if (measure >= this->measures)
+    {
+        return this->measureStarts.back() + (frac - this->measures);
+    }
+    return this->measureStarts[measure] + (frac - measure) * this->signature(measure);
 }
 
 float Chart::pos2frac(float pos) const
 {
-    int measure = 0;
-    while (pos > 0)
+    if (pos < 0)
     {
-        pos -= this->signatures[measure++];
+        return pos;
     }
-    while (pos < 0)
+    if (pos >= this->measureStarts.back())
     {
-        pos += this->signatures[--measure];
+        return this->measures + (pos - this->measureStarts.back());
     }
-    return measure + pos / this->signatures[measure];
+    int measure = (int)(std::upper_bound(this->measureStarts.cbegin(), this->measureStarts.cend(), pos) - this->measureStarts.cbegin()) - 1;
+    return measure + (pos - this->measureStarts[measure]) / this->signature(measure);
 }
 
 float Chart::pos2time(float pos) const
@@ -515,6 +1012,15 @@ float Chart::time2pos(float time) const
     }
 }
 
+std::pair<std::vector<BarLine>::const_iterator, std::vector<BarLine>::const_iterator> Chart::barLinesBetween(float posBegin, float posEnd) const
+{
+    std::vector<BarLine>::const_iterator begin = std::lower_bound(this->barLines.begin(), this->barLines.end(), posBegin, [](const BarLine &line, float pos)
+                                                                  { return line.pos < pos; });
+    std::vector<BarLine>::const_iterator end = std::lower_bound(begin, this->barLines.end(), posEnd, [](const BarLine &line, float pos)
+                                                                { return line.pos < pos; });
+    return std::make_pair(begin, end);
+}
+
 float Sector::pos2time(float pos) const
 {
     return this->time + (this->bpm > 0 ? (pos - this->pos) * 240 / this->bpm : 0);
@@ -525,30 +1031,30 @@ float Sector::time2pos(float time) const
     return this->pos + (time - this->time) / 240 * this->bpm;
 }
 
-static Obj create_bgm(float fraction, int key)
+static Obj create_bgm(const Fraction &fraction, int key)
 {
     Obj obj;
     obj.type = Obj::Type::BGM;
-    obj.pos = fraction;
+    obj.fraction = fraction;
     obj.bgm.key = key;
     return obj;
 }
 
-static Obj create_bmp(float fraction, int key, int layer)
+static Obj create_bmp(const Fraction &fraction, int key, int layer)
 {
     Obj obj;
     obj.type = Obj::Type::BMP;
-    obj.pos = fraction;
+    obj.fraction = fraction;
     obj.bmp.key = key;
     obj.bmp.layer = layer;
     return obj;
 }
 
-static Obj create_note(float fraction, int key, int player, int line, bool end)
+static Obj create_note(const Fraction &fraction, int key, int player, int line, bool end)
 {
     Obj obj;
     obj.type = Obj::Type::NOTE;
-    obj.pos = fraction;
+    obj.fraction = fraction;
     obj.note.player = player;
     obj.note.line = line;
     obj.note.key = key;
@@ -556,24 +1062,54 @@ static Obj create_note(float fraction, int key, int player, int line, bool end)
     return obj;
 }
 
-static Obj create_inv(float fraction, int key, int player, int line)
+static Obj create_inv(const Fraction &fraction, int key, int player, int line)
 {
     Obj obj;
     obj.type = Obj::Type::INVISIBLE;
-    obj.pos = fraction;
+    obj.fraction = fraction;
     obj.misc.player = player;
     obj.misc.line = line;
     obj.misc.key = key;
     return obj;
 }
 
-static Obj create_bomb(float fraction, int damage, int player, int line)
+static Obj create_bomb(const Fraction &fraction, int damage, int player, int line)
 {
     Obj obj;
     obj.type = Obj::Type::BOMB;
-    obj.pos = fraction;
+    obj.fraction = fraction;
     obj.misc.player = player;
     obj.misc.line = line;
     obj.misc.key = damage;
     return obj;
 }
+
+/// Skip the leading whitespace and plus sign std::stoi and std::stof accept.
+static const char *skip_sign(const char *first, const char *last)
+{
+    while (first != last && std::isspace((unsigned char)*first))
+    {
+        first++;
+    }
+    if (first != last && *first == '+' && (last - first == 1 || first[1] != '-'))
+    {
+        first++;
+    }
+    return first;
+}
+
+/// Read an integer the way std::stoi does, using the longest valid prefix.
+template <typename T>
+static std::errc read_number(const char *first, const char *last, int base, T &value)
+{
+    return std::from_chars(skip_sign(first, last), last, value, base).ec;
+}
+
+/**
+ * Read a float the way std::stof does in the C locale.
+ * The decimal point is always '.', whatever LC_NUMERIC is set to.
+ */
+static std::errc read_float(const char *first, const char *last, float &value)
+{
+    return std::from_chars(skip_sign(first, last), last, value).ec;
+}
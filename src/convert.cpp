@@ -1,14 +1,46 @@
 #include <bmsparser/convert.hpp>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include <vector>
 #include "table.hpp"
+#include "table_cp949.hpp"
+
+static const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+static const uint64_t LOW_BITS = 0x0101010101010101ULL;
+
+static bool has_byte(uint64_t word, uint8_t byte);
+static size_t copy_ascii(const char *input, size_t length, char *output, bool sjis);
+static size_t write_utf8(uint16_t unicodeValue, char *output);
+static const std::vector<std::pair<uint16_t, uint16_t>> &sjis_reverse_table();
+static uint16_t sjis_encode(uint16_t unicodeValue);
+static uint16_t cp949_decode(uint8_t lead, uint8_t trail);
+static uint16_t cp949_hangul(size_t index, bool extension);
 
 std::string bms::sjis_to_utf8(const std::string &input)
 {
-    std::string output(3 * input.length(), ' ');
+    std::string output;
+    sjis_to_utf8(input, output);
+    return output;
+}
+
+void bms::sjis_to_utf8(const std::string &input, std::string &output)
+{
+    size_t base = output.length();
+    output.resize(base + 3 * input.length());
+    char *out = &output[0] + base;
+    const char *in = input.data();
     size_t indexInput = 0, indexOutput = 0;
 
     while (indexInput < input.length())
     {
+        size_t ascii = copy_ascii(in + indexInput, input.length() - indexInput, out + indexOutput, true);
+        indexInput += ascii;
+        indexOutput += ascii;
+        if (indexInput >= input.length())
+            break;
+
         char arraySection = ((uint8_t)input[indexInput]) >> 4;
 
         size_t arrayOffset;
@@ -33,23 +65,363 @@ std::string bms::sjis_to_utf8(const std::string &input)
 
         uint16_t unicodeValue = (shiftJIS_convTable[arrayOffset] << 8) | shiftJIS_convTable[arrayOffset + 1];
 
-        if (unicodeValue < 0x80)
+        indexOutput += write_utf8(unicodeValue, out + indexOutput);
+    }
+
+    output.resize(base + indexOutput);
+}
+
+std::string bms::utf8_to_sjis(const std::string &input)
+{
+    std::string output;
+    utf8_to_sjis(input, output);
+    return output;
+}
+
+void bms::utf8_to_sjis(const std::string &input, std::string &output)
+{
+    size_t base = output.length();
+    output.resize(base + input.length());
+    char *out = &output[0] + base;
+    const char *in = input.data();
+    size_t indexInput = 0, indexOutput = 0;
+
+    while (indexInput < input.length())
+    {
+        size_t ascii = copy_ascii(in + indexInput, input.length() - indexInput, out + indexOutput, false);
+        indexInput += ascii;
+        indexOutput += ascii;
+        if (indexInput >= input.length())
+            break;
+
+        uint8_t lead = input[indexInput++];
+        size_t trailing;
+        uint32_t unicodeValue;
+        if ((lead & 0xE0) == 0xC0)
+        {
+            trailing = 1;
+            unicodeValue = lead & 0x1f;
+        }
+        else if ((lead & 0xF0) == 0xE0)
+        {
+            trailing = 2;
+            unicodeValue = lead & 0xf;
+        }
+        else if ((lead & 0xF8) == 0xF0)
+        {
+            trailing = 3;
+            unicodeValue = lead & 0x7;
+        }
+        else
+        {
+            out[indexOutput++] = '?';
+            continue;
+        }
+        for (; trailing > 0 && indexInput < input.length() && ((uint8_t)input[indexInput] & 0xC0) == 0x80; trailing--)
+        {
+            unicodeValue = (unicodeValue << 6) | ((uint8_t)input[indexInput++] & 0x3f);
+        }
+
+        uint16_t code = trailing == 0 && unicodeValue <= 0xFFFF ? sjis_encode(unicodeValue) : 0;
+        if (code > 0xFF)
+        {
+            out[indexOutput++] = code >> 8;
+            out[indexOutput++] = code & 0xff;
+        }
+        else if (code)
+        {
+            out[indexOutput++] = code;
+        }
+        else
+        {
+            out[indexOutput++] = '?';
+        }
+    }
+
+    output.resize(base + indexOutput);
+}
+
+std::vector<std::string> bms::utf8_to_sjis(const std::vector<std::string> &inputs)
+{
+    std::vector<std::string> outputs(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        utf8_to_sjis(inputs[i], outputs[i]);
+    }
+    return outputs;
+}
+
+std::string bms::cp949_to_utf8(const std::string &input)
+{
+    std::string output;
+    cp949_to_utf8(input, output);
+    return output;
+}
+
+void bms::cp949_to_utf8(const std::string &input, std::string &output)
+{
+    size_t base = output.length();
+    output.resize(base + 3 * input.length());
+    char *out = &output[0] + base;
+    const char *in = input.data();
+    size_t indexInput = 0, indexOutput = 0;
+
+    while (indexInput < input.length())
+    {
+        size_t ascii = copy_ascii(in + indexInput, input.length() - indexInput, out + indexOutput, false);
+        indexInput += ascii;
+        indexOutput += ascii;
+        if (indexInput >= input.length())
+            break;
+
+        uint8_t lead = input[indexInput++];
+        uint16_t unicodeValue;
+        if (lead >= 0x81 && lead <= 0xFE)
+        {
+            if (indexInput >= input.length())
+                break;
+            unicodeValue = cp949_decode(lead, input[indexInput++]);
+        }
+        else
+        {
+            unicodeValue = 0x20;
+        }
+
+        indexOutput += write_utf8(unicodeValue, out + indexOutput);
+    }
+
+    output.resize(base + indexOutput);
+}
+
+bms::Encoding bms::detect_encoding(const std::string &input)
+{
+    long sjisScore = 0, cp949Score = 0;
+    size_t sjisErrors = 0, cp949Errors = 0;
+
+    for (size_t i = 0; i < input.length(); i++)
+    {
+        uint8_t lead = input[i];
+        if (lead < 0x80 || (lead >= 0xA1 && lead <= 0xDF))
+            continue;
+        if ((lead >= 0x81 && lead <= 0x9F) || (lead >= 0xE0 && lead <= 0xFC))
         {
-            output[indexOutput++] = unicodeValue;
+            uint8_t trail = i + 1 < input.length() ? input[++i] : 0;
+            if (trail >= 0x40 && trail <= 0xFC && trail != 0x7F)
+                sjisScore += (lead >= 0x82 && lead <= 0x83) || (lead >= 0x88 && lead <= 0x9F) || (lead >= 0xE0 && lead <= 0xEA) ? 2 : 1;
+            else
+                sjisErrors++;
         }
-        else if (unicodeValue < 0x800)
+        else
         {
-            output[indexOutput++] = 0xC0 | (unicodeValue >> 6);
-            output[indexOutput++] = 0x80 | (unicodeValue & 0x3f);
+            sjisErrors++;
+        }
+    }
+
+    for (size_t i = 0; i < input.length(); i++)
+    {
+        uint8_t lead = input[i];
+        if (lead < 0x80)
+            continue;
+        if (lead >= 0x81 && lead <= 0xFE)
+        {
+            uint8_t trail = i + 1 < input.length() ? input[++i] : 0;
+            if ((trail >= 0x41 && trail <= 0x5A) || (trail >= 0x61 && trail <= 0x7A) || (trail >= 0x81 && trail <= 0xFE))
+                cp949Score += lead >= 0xB0 && lead <= 0xC8 && trail >= 0xA1 ? 2 : 1;
+            else
+                cp949Errors++;
         }
         else
         {
-            output[indexOutput++] = 0xE0 | (unicodeValue >> 12);
-            output[indexOutput++] = 0x80 | ((unicodeValue & 0xfff) >> 6);
-            output[indexOutput++] = 0x80 | (unicodeValue & 0x3f);
+            cp949Errors++;
         }
     }
 
-    output.resize(indexOutput);
+    if (cp949Errors != sjisErrors)
+        return cp949Errors < sjisErrors ? Encoding::CP949 : Encoding::ShiftJIS;
+    return cp949Score > sjisScore ? Encoding::CP949 : Encoding::ShiftJIS;
+}
+
+std::string bms::to_utf8(const std::string &input)
+{
+    std::string output;
+    to_utf8(input, output);
     return output;
-}
\ No newline at end of file
+}
+
+void bms::to_utf8(const std::string &input, std::string &output)
+{
+    switch (detect_encoding(input))
+    {
+    case Encoding::ShiftJIS:
+        sjis_to_utf8(input, output);
+        break;
+    case Encoding::CP949:
+        cp949_to_utf8(input, output);
+        break;
+    }
+}
+
+static bool has_byte(uint64_t word, uint8_t byte)
+{
+    uint64_t x = word ^ (LOW_BITS * byte);
+    return ((x - LOW_BITS) & ~x & HIGH_BITS) != 0;
+}
+
+/**
+ * Copy the leading run of bytes that map to themselves, eight at a time.
+ * Shift_JIS remaps 0x5C, 0x7E and 0x7F, so those stop the run as well.
+ */
+static size_t copy_ascii(const char *input, size_t length, char *output, bool sjis)
+{
+    size_t index = 0;
+    while (index + 8 <= length)
+    {
+        uint64_t word;
+        std::memcpy(&word, input + index, 8);
+        if ((word & HIGH_BITS) || (sjis && (has_byte(word, 0x5C) || has_byte(word, 0x7E) || has_byte(word, 0x7F))))
+            break;
+        std::memcpy(output + index, &word, 8);
+        index += 8;
+    }
+    while (index < length)
+    {
+        uint8_t c = input[index];
+        if (c >= 0x80 || (sjis && (c == 0x5C || c == 0x7E || c == 0x7F)))
+            break;
+        output[index++] = c;
+    }
+    return index;
+}
+
+static size_t write_utf8(uint16_t unicodeValue, char *output)
+{
+    if (unicodeValue < 0x80)
+    {
+        output[0] = unicodeValue;
+        return 1;
+    }
+    else if (unicodeValue < 0x800)
+    {
+        output[0] = 0xC0 | (unicodeValue >> 6);
+        output[1] = 0x80 | (unicodeValue & 0x3f);
+        return 2;
+    }
+    else
+    {
+        output[0] = 0xE0 | (unicodeValue >> 12);
+        output[1] = 0x80 | ((unicodeValue & 0xfff) >> 6);
+        output[2] = 0x80 | (unicodeValue & 0x3f);
+        return 3;
+    }
+}
+
+/**
+ * Build the (unicode, code) pairs of non-ASCII characters from shiftJIS_convTable, sorted by unicode.
+ * The table is indexed by single byte, then by lead bytes 0x80~0x8F, 0x90~0x9F and 0xE0~0xEF.
+ * When several codes decode to the same character, the lowest one is kept.
+ */
+static const std::vector<std::pair<uint16_t, uint16_t>> &sjis_reverse_table()
+{
+    static const std::vector<std::pair<uint16_t, uint16_t>> table = []()
+    {
+        static const uint16_t leads[3] = {0x80, 0x90, 0xE0};
+        std::vector<std::pair<uint16_t, uint16_t>> pairs;
+        for (size_t index = 0; index < sizeof(shiftJIS_convTable) / 2; index++)
+        {
+            uint16_t unicodeValue = (shiftJIS_convTable[index * 2] << 8) | shiftJIS_convTable[index * 2 + 1];
+            if (unicodeValue < 0x80)
+                continue;
+            uint16_t code = index < 0x100 ? (uint16_t)index : (uint16_t)(((leads[(index - 0x100) >> 12] | (((index - 0x100) >> 8) & 0xf)) << 8) | (index & 0xff));
+            pairs.push_back(std::make_pair(unicodeValue, code));
+        }
+        std::stable_sort(pairs.begin(), pairs.end(), [](const std::pair<uint16_t, uint16_t> &a, const std::pair<uint16_t, uint16_t> &b)
+                         { return a.first < b.first; });
+        pairs.erase(std::unique(pairs.begin(), pairs.end(), [](const std::pair<uint16_t, uint16_t> &a, const std::pair<uint16_t, uint16_t> &b)
+                                { return a.first == b.first; }),
+                    pairs.end());
+        return pairs;
+    }();
+    return table;
+}
+
+/// Look up the Shift_JIS code of a non-ASCII character.
+static uint16_t sjis_encode(uint16_t unicodeValue)
+{
+    const std::vector<std::pair<uint16_t, uint16_t>> &table = sjis_reverse_table();
+    std::vector<std::pair<uint16_t, uint16_t>>::const_iterator i = std::lower_bound(table.begin(), table.end(), std::make_pair(unicodeValue, (uint16_t)0));
+    if (i != table.end() && i->first == unicodeValue)
+        return i->second;
+    return 0;
+}
+
+/**
+ * Decode a CP949 double-byte character.
+ * Symbols and Hanja of KS X 1001 come from the table, while Hangul syllables
+ * are ranked against the bitmap of the 2350 KS X 1001 syllables: those in rows
+ * B0~C8 are the set bits in order, and the UHC extension holds the rest.
+ */
+static uint16_t cp949_decode(uint8_t lead, uint8_t trail)
+{
+    if (lead >= 0xA1 && trail >= 0xA1)
+    {
+        if (trail == 0xFF)
+            return 0x20;
+        size_t column = trail - 0xA1;
+        if (lead <= 0xAC)
+            return (cp949_convTable[((lead - 0xA1) * 94 + column) * 2] << 8) | cp949_convTable[((lead - 0xA1) * 94 + column) * 2 + 1];
+        if (lead >= 0xB0 && lead <= 0xC8)
+            return cp949_hangul((lead - 0xB0) * 94 + column, false);
+        if (lead >= 0xCA && lead <= 0xFD)
+            return (cp949_convTable[((lead - 0xCA + 12) * 94 + column) * 2] << 8) | cp949_convTable[((lead - 0xCA + 12) * 94 + column) * 2 + 1];
+        return 0x20;
+    }
+
+    size_t column;
+    if (trail >= 0x41 && trail <= 0x5A)
+        column = trail - 0x41;
+    else if (trail >= 0x61 && trail <= 0x7A)
+        column = trail - 0x61 + 26;
+    else if (trail >= 0x81 && trail <= 0xFE)
+        column = trail - 0x81 + 52;
+    else
+        return 0x20;
+
+    size_t index;
+    if (lead <= 0xA0)
+        index = (lead - 0x81) * 178 + column;
+    else
+        index = 32 * 178 + (lead - 0xA1) * 84 + column;
+    return index < 8822 ? cp949_hangul(index, true) : 0x20;
+}
+
+/**
+ * Find the index-th syllable that is (or, for the extension, is not) in KS X 1001.
+ */
+static uint16_t cp949_hangul(size_t index, bool extension)
+{
+    size_t low = 0, high = 175;
+    while (high - low > 1)
+    {
+        size_t mid = (low + high) / 2;
+        size_t before = extension ? mid * 64 - cp949_hangulRank[mid] : cp949_hangulRank[mid];
+        if (before <= index)
+            low = mid;
+        else
+            high = mid;
+    }
+
+    uint64_t mask = extension ? ~cp949_hangulMask[low] : cp949_hangulMask[low];
+    if (low == 174)
+        mask &= (1ULL << (11172 - 174 * 64)) - 1;
+    size_t remain = index - (extension ? low * 64 - cp949_hangulRank[low] : cp949_hangulRank[low]);
+    for (int bit = 0; bit < 64; bit++)
+    {
+        if (mask >> bit & 1)
+        {
+            if (remain == 0)
+                return 0xAC00 + low * 64 + bit;
+            remain--;
+        }
+    }
+    return 0x20;
+}
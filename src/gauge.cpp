@@ -0,0 +1,116 @@
+#include <bmsparser/gauge.hpp>
+#include <algorithm>
+
+using namespace bms;
+
+Gauge::Gauge(Type type, const Chart &chart)
+{
+    this->type = type;
+    this->min = 0;
+    this->max = 100;
+    this->lowThreshold = 0;
+    this->lowFactor = 1;
+
+    float a = chart.stats.notes > 0 ? chart.total / chart.stats.notes : 0;
+    switch (type)
+    {
+    case Type::GROOVE:
+    {
+        const float increments[6] = {a, a, a / 2, -4, -6, -2};
+        std::copy(increments, increments + 6, this->increments);
+        this->initial = 20;
+        this->min = 2;
+        this->border = 80;
+        this->survival = false;
+        break;
+    }
+    case Type::EASY:
+    {
+        const float increments[6] = {a * 1.2f, a * 1.2f, a * 0.6f, -3.2f, -4.8f, -1.6f};
+        std::copy(increments, increments + 6, this->increments);
+        this->initial = 20;
+        this->min = 2;
+        this->border = 80;
+        this->survival = false;
+        break;
+    }
+    case Type::HARD:
+    {
+        const float increments[6] = {0.16f, 0.16f, 0, -5, -9, -5};
+        std::copy(increments, increments + 6, this->increments);
+        this->initial = 100;
+        this->border = 0;
+        this->survival = true;
+        this->lowThreshold = 30;
+        this->lowFactor = 0.6f;
+        break;
+    }
+    case Type::EXHARD:
+    {
+        const float increments[6] = {0.16f, 0.16f, 0, -10, -18, -10};
+        std::copy(increments, increments + 6, this->increments);
+        this->initial = 100;
+        this->border = 0;
+        this->survival = true;
+        break;
+    }
+    case Type::HAZARD:
+    {
+        const float increments[6] = {0.16f, 0.16f, 0, -100, -100, -10};
+        std::copy(increments, increments + 6, this->increments);
+        this->initial = 100;
+        this->border = 0;
+        this->survival = true;
+        break;
+    }
+    }
+}
+
+float Gauge::apply(float value, unsigned char judgement) const
+{
+    if (this->survival && value <= 0)
+    {
+        return 0;
+    }
+    float increment = this->increments[judgement];
+    if (increment < 0 && value < this->lowThreshold)
+    {
+        increment *= this->lowFactor;
+    }
+    return std::min(std::max(value + increment, this->min), this->max);
+}
+
+float Gauge::evaluate(const std::vector<unsigned char> &judgements) const
+{
+    float value = this->initial;
+    for (unsigned char judgement : judgements)
+    {
+        value = this->apply(value, judgement);
+    }
+    return value;
+}
+
+void Gauge::evaluate(const unsigned char *judgements, size_t steps, size_t replays, float *values) const
+{
+    std::fill(values, values + replays, this->initial);
+    const float lowFactor = this->lowFactor, lowThreshold = this->lowThreshold, min = this->min, max = this->max;
+    const float dead = this->survival ? 0 : -1;
+    for (size_t step = 0; step < steps; step++)
+    {
+        const unsigned char *row = judgements + step * replays;
+        for (size_t r = 0; r < replays; r++)
+        {
+            // Branch-free form of apply().
+            float value = values[r];
+            float increment = this->increments[row[r]];
+            float scale = increment < 0 && value < lowThreshold ? lowFactor : 1;
+            float next = std::min(std::max(value + increment * scale, min), max);
+            values[r] = value <= dead ? value : next;
+        }
+    }
+}
+
+bool Gauge::cleared(float value) const
+{
+    return this->survival ? value > 0 : value >= this->border;
+}
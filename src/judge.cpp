@@ -0,0 +1,242 @@
+#include <bmsparser/judge.hpp>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+using namespace bms;
+
+JudgeWindows::JudgeWindows(int rank)
+{
+    switch (rank)
+    {
+    case 0:
+        *this = JudgeWindows(0.008f, 0.024f, 0.040f, 0.200f, 0.500f);
+        break;
+    case 1:
+        *this = JudgeWindows(0.015f, 0.030f, 0.060f, 0.200f, 0.500f);
+        break;
+    case 3:
+        *this = JudgeWindows(0.021f, 0.060f, 0.120f, 0.200f, 0.500f);
+        break;
+    default:
+        *this = JudgeWindows(0.018f, 0.040f, 0.100f, 0.200f, 0.500f);
+        break;
+    }
+}
+
+JudgeTable::JudgeTable(const Chart &chart)
+{
+    this->total = 0;
+    for (const Obj &obj : chart.objs)
+    {
+        switch (obj.type)
+        {
+        case Obj::Type::NOTE:
+        {
+            int lane = (obj.note.player - 1) * 9 + obj.note.line - 1;
+            if (lane < 0 || lane >= LANES)
+            {
+                break;
+            }
+            std::vector<JudgeNote> &notes = this->notes[lane];
+            if (!obj.note.end)
+            {
+                notes.push_back(JudgeNote{obj.time, -1});
+                this->total++;
+            }
+            else if (!notes.empty() && notes.back().end < 0)
+            {
+                notes.back().end = obj.time;
+            }
+            break;
+        }
+        case Obj::Type::BOMB:
+        {
+            int lane = (obj.misc.player - 1) * 9 + obj.misc.line - 1;
+            if (lane >= 0 && lane < LANES)
+            {
+                this->mines[lane].push_back(JudgeMine{obj.time, obj.misc.key});
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+Judge::Judge(const JudgeTable &table, const JudgeWindows &windows) : table(table), windows(windows)
+{
+    this->sequence = nullptr;
+    this->reset();
+}
+
+void Judge::reset()
+{
+    for (int i = 0; i < 5; i++)
+    {
+        this->counts[i] = 0;
+    }
+    this->emptyPoors = 0;
+    this->combo = 0;
+    this->maxCombo = 0;
+    this->damage = 0;
+    this->last = Judgement::NONE;
+    for (int lane = 0; lane < LANES; lane++)
+    {
+        this->nextNote[lane] = 0;
+        this->nextMine[lane] = 0;
+        this->holding[lane] = -1;
+        this->holdJudgement[lane] = Judgement::NONE;
+        this->down[lane] = false;
+    }
+    this->deadline = -std::numeric_limits<float>::infinity();
+}
+
+Judgement Judge::press(int lane, float time)
+{
+    this->update(time);
+    if (lane < 0 || lane >= LANES)
+    {
+        return Judgement::NONE;
+    }
+    this->down[lane] = true;
+    if (this->holding[lane] >= 0)
+    {
+        return Judgement::NONE;
+    }
+
+    const std::vector<JudgeNote> &notes = this->table.notes[lane];
+    size_t &next = this->nextNote[lane];
+    if (next >= notes.size())
+    {
+        return Judgement::NONE;
+    }
+
+    const JudgeNote &note = notes[next];
+    float offset = std::fabs(time - note.time);
+    if (offset <= this->windows.bad)
+    {
+        Judgement judgement = offset <= this->windows.pgreat ? Judgement::PGREAT
+                              : offset <= this->windows.great ? Judgement::GREAT
+                              : offset <= this->windows.good  ? Judgement::GOOD
+                                                              : Judgement::BAD;
+        if (note.end >= 0 && judgement != Judgement::BAD)
+        {
+            // A long note is recorded once, when it ends.
+            this->holding[lane] = (long)next;
+            this->holdJudgement[lane] = judgement;
+            this->deadline = std::min(this->deadline, note.end);
+        }
+        else
+        {
+            this->record(judgement);
+        }
+        next++;
+        return judgement;
+    }
+    if (note.time - time <= this->windows.poor)
+    {
+        this->emptyPoors++;
+        this->last = Judgement::EMPTY_POOR;
+        if (this->sequence)
+        {
+            this->sequence->push_back((unsigned char)Judgement::EMPTY_POOR);
+        }
+        return Judgement::EMPTY_POOR;
+    }
+    return Judgement::NONE;
+}
+
+Judgement Judge::release(int lane, float time)
+{
+    this->update(time);
+    if (lane < 0 || lane >= LANES)
+    {
+        return Judgement::NONE;
+    }
+    this->down[lane] = false;
+    if (this->holding[lane] < 0)
+    {
+        return Judgement::NONE;
+    }
+
+    const JudgeNote &note = this->table.notes[lane][this->holding[lane]];
+    Judgement judgement = time >= note.end - this->windows.good ? this->holdJudgement[lane] : Judgement::BAD;
+    this->holding[lane] = -1;
+    this->record(judgement);
+    return judgement;
+}
+
+void Judge::update(float time)
+{
+    if (time < this->deadline)
+    {
+        return;
+    }
+
+    this->deadline = std::numeric_limits<float>::infinity();
+    for (int lane = 0; lane < LANES; lane++)
+    {
+        if (this->holding[lane] >= 0 && time >= this->table.notes[lane][this->holding[lane]].end)
+        {
+            this->holding[lane] = -1;
+            this->record(this->holdJudgement[lane]);
+        }
+
+        const std::vector<JudgeNote> &notes = this->table.notes[lane];
+        size_t &next = this->nextNote[lane];
+        while (next < notes.size() && notes[next].time + this->windows.bad < time)
+        {
+            this->record(Judgement::POOR);
+            next++;
+        }
+
+        const std::vector<JudgeMine> &mines = this->table.mines[lane];
+        size_t &mine = this->nextMine[lane];
+        while (mine < mines.size() && mines[mine].time <= time)
+        {
+            if (this->down[lane])
+            {
+                this->damage += mines[mine].damage;
+            }
+            mine++;
+        }
+
+        if (this->holding[lane] >= 0)
+        {
+            this->deadline = std::min(this->deadline, notes[this->holding[lane]].end);
+        }
+        if (next < notes.size())
+        {
+            this->deadline = std::min(this->deadline, notes[next].time + this->windows.bad);
+        }
+        if (mine < mines.size())
+        {
+            this->deadline = std::min(this->deadline, mines[mine].time);
+        }
+    }
+}
+
+int Judge::exScore() const
+{
+    return this->counts[(int)Judgement::PGREAT] * 2 + this->counts[(int)Judgement::GREAT];
+}
+
+void Judge::record(Judgement judgement)
+{
+    this->counts[(int)judgement]++;
+    this->last = judgement;
+    if (this->sequence)
+    {
+        this->sequence->push_back((unsigned char)judgement);
+    }
+    if (judgement == Judgement::BAD || judgement == Judgement::POOR)
+    {
+        this->combo = 0;
+    }
+    else if (++this->combo > this->maxCombo)
+    {
+        this->maxCombo = this->combo;
+    }
+}
@@ -0,0 +1,170 @@
+#include <bmsparser/keysound.hpp>
+#include <algorithm>
+
+using namespace bms;
+
+static int keysound_of(const Obj &obj);
+
+KeysoundSchedule bms::scheduleKeysounds(const Chart &chart, float lookahead, float release)
+{
+    KeysoundSchedule schedule;
+
+    int slots[1296];
+    std::fill(slots, slots + 1296, -1);
+
+    // Start of the resident window currently open for each used key, parallel to usages.
+    std::vector<float> opened;
+
+    for (const Obj &obj : chart.objs)
+    {
+        int key = keysound_of(obj);
+        if (key <= 0)
+        {
+            continue;
+        }
+
+        if (slots[key] < 0)
+        {
+            slots[key] = (int)schedule.usages.size();
+            schedule.usages.push_back(KeysoundUsage{key, obj.time, obj.time, 1});
+            opened.push_back(obj.time);
+            continue;
+        }
+
+        KeysoundUsage &usage = schedule.usages[slots[key]];
+        if (obj.time - lookahead > usage.last + release)
+        {
+            schedule.events.push_back(KeysoundEvent{KeysoundEvent::Type::LOAD, opened[slots[key]] - lookahead, key});
+            schedule.events.push_back(KeysoundEvent{KeysoundEvent::Type::EVICT, usage.last + release, key});
+            opened[slots[key]] = obj.time;
+        }
+        usage.last = obj.time;
+        usage.count++;
+    }
+
+    for (size_t i = 0; i < schedule.usages.size(); i++)
+    {
+        const KeysoundUsage &usage = schedule.usages[i];
+        schedule.events.push_back(KeysoundEvent{KeysoundEvent::Type::LOAD, opened[i] - lookahead, usage.key});
+        schedule.events.push_back(KeysoundEvent{KeysoundEvent::Type::EVICT, usage.last + release, usage.key});
+    }
+
+    std::stable_sort(schedule.events.begin(), schedule.events.end(), [](const KeysoundEvent &a, const KeysoundEvent &b)
+                     { return a.time < b.time || (a.time == b.time && a.type == KeysoundEvent::Type::EVICT && b.type == KeysoundEvent::Type::LOAD); });
+
+    return schedule;
+}
+
+PolyphonyProfile bms::profilePolyphony(const Chart &chart, const std::vector<float> &durations, float defaultDuration)
+{
+    PolyphonyProfile profile;
+    profile.peak = 0;
+    profile.peakTime = 0;
+
+    // A negative length would end a voice before it starts and drive the count below 0.
+    if (!(defaultDuration > 0))
+    {
+        defaultDuration = 0;
+    }
+
+    // Voice boundaries: +1 at the start of a voice, -1 at its end.
+    std::vector<std::pair<float, int>> edges;
+    float ends[1296];
+    std::fill(ends, ends + 1296, -1.0f);
+    size_t lastStart[1296];
+
+    for (const Obj &obj : chart.objs)
+    {
+        int key;
+        if (obj.type == Obj::Type::BGM)
+            key = obj.bgm.key;
+        else if (obj.type == Obj::Type::NOTE && !obj.note.end)
+            key = obj.note.key;
+        else
+            continue;
+        if (key <= 0)
+        {
+            continue;
+        }
+
+        if (ends[key] > obj.time)
+        {
+            profile.retriggers.push_back(KeysoundRetrigger{obj.time, key, ends[key] - obj.time});
+            edges[lastStart[key] + 1].first = obj.time;
+        }
+
+        float duration = key < (int)durations.size() && durations[key] > 0 ? durations[key] : defaultDuration;
+        ends[key] = obj.time + duration;
+        lastStart[key] = edges.size();
+        edges.push_back(std::make_pair(obj.time, 1));
+        edges.push_back(std::make_pair(obj.time + duration, -1));
+    }
+
+    // Ends sort ahead of starts at the same time, so back-to-back voices do not overlap.
+    std::sort(edges.begin(), edges.end());
+
+    int voices = 0;
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        voices += edges[i].second;
+        if (i + 1 < edges.size() && edges[i + 1].first == edges[i].first)
+        {
+            continue;
+        }
+        if (voices > profile.peak)
+        {
+            profile.peak = voices;
+            profile.peakTime = edges[i].first;
+        }
+        if (!profile.curve.empty())
+        {
+            const std::pair<float, int> &last = profile.curve.back();
+            if (last.second == voices)
+            {
+                continue;
+            }
+            if ((int)profile.histogram.size() <= last.second)
+            {
+                profile.histogram.resize(last.second + 1, 0);
+            }
+            profile.histogram[last.second] += edges[i].first - last.first;
+        }
+        profile.curve.push_back(std::make_pair(edges[i].first, voices));
+    }
+
+    return profile;
+}
+
+int PolyphonyProfile::percentile(float p) const
+{
+    float total = 0;
+    for (float time : this->histogram)
+    {
+        total += time;
+    }
+    float sum = 0;
+    for (size_t voices = 0; voices < this->histogram.size(); voices++)
+    {
+        sum += this->histogram[voices];
+        if (sum >= p * total)
+        {
+            return (int)voices;
+        }
+    }
+    return this->peak;
+}
+
+static int keysound_of(const Obj &obj)
+{
+    switch (obj.type)
+    {
+    case Obj::Type::BGM:
+        return obj.bgm.key;
+    case Obj::Type::NOTE:
+        return obj.note.key;
+    case Obj::Type::INVISIBLE:
+        return obj.misc.key;
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,81 @@
+#include <bmsparser/memory.hpp>
+#include <bmsparser.hpp>
+#include <atomic>
+
+using namespace bms;
+
+static std::atomic<size_t> allocationCount(0), allocatedBytes(0), liveBytes(0), peakBytes(0);
+
+template <typename T>
+static size_t capacity_of(const std::vector<T> &items);
+static size_t heap_of(const std::string &text);
+
+AllocationStats bms::allocationStats()
+{
+    return AllocationStats{allocationCount.load(), allocatedBytes.load(), liveBytes.load(), peakBytes.load()};
+}
+
+void bms::resetAllocationPeak()
+{
+    peakBytes.store(liveBytes.load());
+}
+
+void bms::countAllocation(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    size_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+}
+
+void bms::countDeallocation(size_t size)
+{
+    liveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+size_t MemoryUsage::total() const
+{
+    return this->chart + this->strings + this->wavs + this->bmps + this->objs + this->sectors + this->measures + this->bgas + this->barLines + this->randoms;
+}
+
+MemoryUsage Chart::memoryUsage() const
+{
+    MemoryUsage usage{};
+    usage.chart = sizeof(Chart);
+    for (const std::string *text : {&this->filename, &this->genre, &this->title, &this->artist, &this->subtitle, &this->subartist, &this->stagefile, &this->banner})
+    {
+        usage.strings += heap_of(*text);
+    }
+    usage.wavs = usage.bmps = 1296 * sizeof(std::string);
+    for (int i = 0; i < 1296; i++)
+    {
+        usage.wavs += heap_of(this->wavs[i]);
+        usage.bmps += heap_of(this->bmps[i]);
+    }
+    usage.objs = capacity_of(this->objs);
+    usage.sectors = capacity_of(this->sectors);
+    usage.measures = capacity_of(this->signatures) + capacity_of(this->measureStarts);
+    for (int i = 0; i < 3; i++)
+    {
+        usage.bgas += capacity_of(this->bgas[i]);
+    }
+    usage.bgas += capacity_of(this->bmpOrder);
+    usage.barLines = capacity_of(this->barLines);
+    usage.randoms = capacity_of(this->randoms);
+    return usage;
+}
+
+template <typename T>
+static size_t capacity_of(const std::vector<T> &items)
+{
+    return items.capacity() * sizeof(T);
+}
+
+/// Bytes a string holds outside itself, none while it fits in the small string buffer.
+static size_t heap_of(const std::string &text)
+{
+    return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+}
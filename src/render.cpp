@@ -0,0 +1,179 @@
+#include <bmsparser/render.hpp>
+#include <algorithm>
+
+using namespace bms;
+
+static LaneSpan find_span(const std::vector<LaneObj> &objs, float posBegin, float posEnd);
+static size_t advance_sector(const std::vector<Sector> &sectors, size_t sector, float time);
+
+LaneIndex::LaneIndex(const Chart &chart)
+{
+    for (size_t i = 0; i < chart.objs.size(); i++)
+    {
+        const Obj &obj = chart.objs[i];
+        switch (obj.type)
+        {
+        case Obj::Type::NOTE:
+        {
+            int lane = (obj.note.player - 1) * 9 + obj.note.line - 1;
+            if (lane < 0 || lane >= LANES)
+            {
+                break;
+            }
+            std::vector<LaneObj> &notes = this->notes[lane];
+            if (!obj.note.end)
+            {
+                notes.push_back(LaneObj{obj.pos, obj.pos, obj.note.key, i});
+            }
+            else if (!notes.empty() && notes.back().end == notes.back().pos)
+            {
+                notes.back().end = obj.pos;
+            }
+            break;
+        }
+        case Obj::Type::INVISIBLE:
+        case Obj::Type::BOMB:
+        {
+            int lane = (obj.misc.player - 1) * 9 + obj.misc.line - 1;
+            if (lane >= 0 && lane < LANES)
+            {
+                (obj.type == Obj::Type::BOMB ? this->bombs : this->invisibles)[lane].push_back(LaneObj{obj.pos, obj.pos, obj.misc.key, i});
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+VisibleRange LaneIndex::visibleRange(float posBegin, float posEnd, unsigned int typeMask) const
+{
+    VisibleRange range;
+    // A window that ends before it begins, e.g. from a hi-speed that is not positive, holds nothing.
+    bool empty = !(posBegin <= posEnd);
+    for (int lane = 0; lane < LANES; lane++)
+    {
+        if (empty)
+        {
+            range.notes[lane] = range.invisibles[lane] = range.bombs[lane] = LaneSpan{nullptr, nullptr};
+            continue;
+        }
+        range.notes[lane] = typeMask & 1u << (int)Obj::Type::NOTE ? find_span(this->notes[lane], posBegin, posEnd) : LaneSpan{nullptr, nullptr};
+        range.invisibles[lane] = typeMask & 1u << (int)Obj::Type::INVISIBLE ? find_span(this->invisibles[lane], posBegin, posEnd) : LaneSpan{nullptr, nullptr};
+        range.bombs[lane] = typeMask & 1u << (int)Obj::Type::BOMB ? find_span(this->bombs[lane], posBegin, posEnd) : LaneSpan{nullptr, nullptr};
+    }
+    return range;
+}
+
+static LaneSpan find_span(const std::vector<LaneObj> &objs, float posBegin, float posEnd)
+{
+    const LaneObj *data = objs.data();
+    const LaneObj *begin = std::lower_bound(data, data + objs.size(), posBegin, [](const LaneObj &obj, float pos)
+                                            { return obj.pos < pos; });
+    // Objects of one lane never overlap, so only the one just before can reach into the window.
+    if (begin != data && (begin - 1)->end >= posBegin)
+    {
+        begin--;
+    }
+    const LaneObj *end = std::lower_bound(begin, data + objs.size(), posEnd, [](const LaneObj &obj, float pos)
+                                          { return obj.pos < pos; });
+    return LaneSpan{begin, end};
+}
+
+RenderCursor::RenderCursor(const Chart &chart, const LaneIndex &index, unsigned int typeMask) : chart(chart), typeMask(typeMask)
+{
+    this->lanes[0] = index.notes;
+    this->lanes[1] = index.invisibles;
+    this->lanes[2] = index.bombs;
+    this->sector = 0;
+    this->seek(0, 0);
+}
+
+size_t RenderCursor::fill(float time, float hiSpeed, NoteInstance *buffer, size_t capacity)
+{
+    if (!(hiSpeed > 0))
+    {
+        return 0;
+    }
+    this->sector = advance_sector(this->chart.sectors, this->sector, time);
+    float posBegin = this->chart.sectors[this->sector].time2pos(time);
+    float posEnd = posBegin + 1 / hiSpeed;
+
+    if (posBegin < this->posBegin)
+    {
+        this->seek(posBegin, posEnd);
+    }
+    this->posBegin = posBegin;
+
+    size_t count = 0;
+    for (int type = 0; type < 3; type++)
+    {
+        if (!(this->typeMask & 1u << ((int)Obj::Type::NOTE + type)))
+        {
+            continue;
+        }
+        for (int lane = 0; lane < LANES; lane++)
+        {
+            const std::vector<LaneObj> &objs = this->lanes[type][lane];
+            size_t &first = this->first[type][lane];
+            size_t &last = this->last[type][lane];
+            while (first < objs.size() && objs[first].end < posBegin)
+            {
+                first++;
+            }
+            last = std::max(last, first);
+            while (last < objs.size() && objs[last].pos < posEnd)
+            {
+                last++;
+            }
+            while (last > first && objs[last - 1].pos >= posEnd)
+            {
+                last--;
+            }
+            for (size_t i = first; i < last && count < capacity; i++)
+            {
+                buffer[count++] = NoteInstance{
+                    (objs[i].pos - posBegin) * hiSpeed,
+                    (objs[i].end - objs[i].pos) * hiSpeed,
+                    (uint16_t)lane,
+                    (uint16_t)((int)Obj::Type::NOTE + type),
+                };
+            }
+        }
+    }
+    return count;
+}
+
+void RenderCursor::seek(float posBegin, float posEnd)
+{
+    this->posBegin = posBegin;
+    for (int type = 0; type < 3; type++)
+    {
+        for (int lane = 0; lane < LANES; lane++)
+        {
+            const std::vector<LaneObj> &objs = this->lanes[type][lane];
+            LaneSpan span = find_span(objs, posBegin, posEnd);
+            this->first[type][lane] = span.begin - objs.data();
+            this->last[type][lane] = span.end - objs.data();
+        }
+    }
+}
+
+/**
+ * Find the sector Chart::time2pos uses at a time, moving from the sector of the last frame.
+ * Costs O(1) per sector passed in either direction.
+ */
+static size_t advance_sector(const std::vector<Sector> &sectors, size_t sector, float time)
+{
+    while (sector + 1 < sectors.size() && sectors[sector + 1].time <= time)
+    {
+        sector++;
+    }
+    // Sectors starting exactly at the time only count if they are inclusive.
+    while (sector > 0 && !(sectors[sector].time < time || (sectors[sector].inclusive && sectors[sector].time == time)))
+    {
+        sector--;
+    }
+    return sector;
+}
@@ -0,0 +1,79 @@
+#include <bmsparser/replay.hpp>
+#include <bmsparser/trace.hpp>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <limits>
+
+using namespace bms;
+
+static ReplayResult run(Judge &judge, const std::vector<ReplayInput> &inputs);
+
+ReplayResult bms::simulateReplay(const JudgeTable &table, const JudgeWindows &windows, const std::vector<ReplayInput> &inputs)
+{
+    Judge judge(table, windows);
+    return run(judge, inputs);
+}
+
+std::vector<ReplayResult> bms::simulateReplays(const JudgeTable &table, const JudgeWindows &windows, const std::vector<std::vector<ReplayInput>> &replays, unsigned int threads)
+{
+    std::vector<ReplayResult> results(replays.size());
+    if (threads == 0)
+    {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threads = (unsigned int)std::min<size_t>(threads, replays.size());
+
+    // Replays are handed out one at a time, so a long one does not hold up a whole slice.
+    std::atomic<size_t> next(0);
+    auto work = [&]()
+    {
+        Judge judge(table, windows);
+        for (size_t i = next++; i < replays.size(); i = next++)
+        {
+            BMS_TRACE_SCOPE("simulateReplay");
+            judge.reset();
+            results[i] = run(judge, replays[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; i++)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    return results;
+}
+
+static ReplayResult run(Judge &judge, const std::vector<ReplayInput> &inputs)
+{
+    for (const ReplayInput &input : inputs)
+    {
+        if (input.down)
+        {
+            judge.press(input.lane, input.time);
+        }
+        else
+        {
+            judge.release(input.lane, input.time);
+        }
+    }
+    judge.update(std::numeric_limits<float>::infinity());
+
+    ReplayResult result;
+    for (int i = 0; i < 5; i++)
+    {
+        result.counts[i] = judge.counts[i];
+    }
+    result.emptyPoors = judge.emptyPoors;
+    result.maxCombo = judge.maxCombo;
+    result.exScore = judge.exScore();
+    result.damage = judge.damage;
+    return result;
+}
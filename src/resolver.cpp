@@ -0,0 +1,153 @@
+#include <bmsparser/resolver.hpp>
+#include <filesystem>
+#include <vector>
+#include <algorithm>
+
+using namespace bms;
+
+static std::string fold(const std::string &name);
+static std::string stem(const std::string &name);
+
+std::string Resolver::resolve(const std::string &path)
+{
+    std::string normalized = path;
+    std::replace(normalized.begin(), normalized.end(), '\\', '/');
+
+    size_t slash = normalized.find_last_of('/');
+    std::string parent = slash == std::string::npos ? "" : normalized.substr(0, slash + 1);
+    std::string name = normalized.substr(slash == std::string::npos ? 0 : slash + 1);
+
+    const Directory &dir = this->directory(parent);
+    if (!dir.exists || name.empty())
+    {
+        return "";
+    }
+
+    std::string folded = fold(name);
+    std::unordered_map<std::string, std::string>::const_iterator i = dir.names.find(folded);
+    if (i == dir.names.end())
+    {
+        i = dir.stems.find(stem(folded));
+        if (i == dir.stems.end())
+        {
+            return "";
+        }
+    }
+    return dir.path + i->second;
+}
+
+void Resolver::resolve(Chart &chart)
+{
+    for (int i = 0; i < 1296; i++)
+    {
+        if (!chart.wavs[i].empty())
+        {
+            std::string file = this->resolve(chart.wavs[i]);
+            if (!file.empty())
+            {
+                chart.wavs[i] = file;
+            }
+        }
+        if (!chart.bmps[i].empty())
+        {
+            std::string file = this->resolve(chart.bmps[i]);
+            if (!file.empty())
+            {
+                chart.bmps[i] = file;
+            }
+        }
+    }
+    for (std::string *path : {&chart.stagefile, &chart.banner})
+    {
+        if (!path->empty())
+        {
+            std::string file = this->resolve(*path);
+            if (!file.empty())
+            {
+                *path = file;
+            }
+        }
+    }
+}
+
+void Resolver::clear()
+{
+    this->directories.clear();
+}
+
+const Resolver::Directory &Resolver::directory(const std::string &path)
+{
+    std::unordered_map<std::string, Directory>::iterator found = this->directories.find(path);
+    if (found != this->directories.end())
+    {
+        return found->second;
+    }
+
+    Directory dir;
+    dir.path = path;
+    dir.exists = false;
+
+    std::error_code error;
+    if (!std::filesystem::is_directory(path.empty() ? "." : path, error) && path.length() > 1)
+    {
+        // The directory is not there as written, so look it up case-insensitively in its parent.
+        size_t slash = path.find_last_of('/', path.length() - 2);
+        std::string parent = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+        std::string name = path.substr(parent.length(), path.length() - parent.length() - 1);
+        const Directory &up = this->directory(parent);
+        std::unordered_map<std::string, std::string>::const_iterator i = up.dirs.find(fold(name));
+        if (i != up.dirs.end())
+        {
+            dir.path = up.path + i->second + "/";
+        }
+    }
+
+    std::vector<std::string> files;
+    for (std::filesystem::directory_iterator i(dir.path.empty() ? "." : dir.path, error), end; !error && i != end; i.increment(error))
+    {
+        std::error_code type;
+        std::string name = i->path().filename().string();
+        if (i->is_directory(type))
+        {
+            dir.dirs.emplace(fold(name), name);
+        }
+        else
+        {
+            files.push_back(name);
+        }
+    }
+    if (!error)
+    {
+        dir.exists = true;
+    }
+
+    // Sort so that the file picked for a shared stem does not depend on listing order.
+    std::sort(files.begin(), files.end());
+    for (const std::string &name : files)
+    {
+        std::string folded = fold(name);
+        dir.stems.emplace(stem(folded), name);
+        dir.names.emplace(std::move(folded), name);
+    }
+
+    return this->directories.emplace(path, std::move(dir)).first->second;
+}
+
+static std::string fold(const std::string &name)
+{
+    std::string folded = name;
+    for (char &c : folded)
+    {
+        if (c >= 'A' && c <= 'Z')
+        {
+            c += 'a' - 'A';
+        }
+    }
+    return folded;
+}
+
+static std::string stem(const std::string &name)
+{
+    size_t dot = name.find_last_of('.');
+    return dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+}
@@ -0,0 +1,1583 @@
+#ifndef __BMSPARSER_TABLE_CP949_HPP__
+#define __BMSPARSER_TABLE_CP949_HPP__
+
+const unsigned char cp949_convTable[12032] = {
+	0x30, 0x00, 0x30, 0x01, 0x30, 0x02, 0x00, 0xb7, 
+	0x20, 0x25, 0x20, 0x26, 0x00, 0xa8, 0x30, 0x03, 
+	0x00, 0xad, 0x20, 0x15, 0x22, 0x25, 0xff, 0x3c, 
+	0x22, 0x3c, 0x20, 0x18, 0x20, 0x19, 0x20, 0x1c, 
+	0x20, 0x1d, 0x30, 0x14, 0x30, 0x15, 0x30, 0x08, 
+	0x30, 0x09, 0x30, 0x0a, 0x30, 0x0b, 0x30, 0x0c, 
+	0x30, 0x0d, 0x30, 0x0e, 0x30, 0x0f, 0x30, 0x10, 
+	0x30, 0x11, 0x00, 0xb1, 0x00, 0xd7, 0x00, 0xf7, 
+	0x22, 0x60, 0x22, 0x64, 0x22, 0x65, 0x22, 0x1e, 
+	0x22, 0x34, 0x00, 0xb0, 0x20, 0x32, 0x20, 0x33, 
+	0x21, 0x03, 0x21, 0x2b, 0xff, 0xe0, 0xff, 0xe1, 
+	0xff, 0xe5, 0x26, 0x42, 0x26, 0x40, 0x22, 0x20, 
+	0x22, 0xa5, 0x23, 0x12, 0x22, 0x02, 0x22, 0x07, 
+	0x22, 0x61, 0x22, 0x52, 0x00, 0xa7, 0x20, 0x3b, 
+	0x26, 0x06, 0x26, 0x05, 0x25, 0xcb, 0x25, 0xcf, 
+	0x25, 0xce, 0x25, 0xc7, 0x25, 0xc6, 0x25, 0xa1, 
+	0x25, 0xa0, 0x25, 0xb3, 0x25, 0xb2, 0x25, 0xbd, 
+	0x25, 0xbc, 0x21, 0x92, 0x21, 0x90, 0x21, 0x91, 
+	0x21, 0x93, 0x21, 0x94, 0x30, 0x13, 0x22, 0x6a, 
+	0x22, 0x6b, 0x22, 0x1a, 0x22, 0x3d, 0x22, 0x1d, 
+	0x22, 0x35, 0x22, 0x2b, 0x22, 0x2c, 0x22, 0x08, 
+	0x22, 0x0b, 0x22, 0x86, 0x22, 0x87, 0x22, 0x82, 
+	0x22, 0x83, 0x22, 0x2a, 0x22, 0x29, 0x22, 0x27, 
+	0x22, 0x28, 0xff, 0xe2, 0x21, 0xd2, 0x21, 0xd4, 
+	0x22, 0x00, 0x22, 0x03, 0x00, 0xb4, 0xff, 0x5e, 
+	0x02, 0xc7, 0x02, 0xd8, 0x02, 0xdd, 0x02, 0xda, 
+	0x02, 0xd9, 0x00, 0xb8, 0x02, 0xdb, 0x00, 0xa1, 
+	0x00, 0xbf, 0x02, 0xd0, 0x22, 0x2e, 0x22, 0x11, 
+	0x22, 0x0f, 0x00, 0xa4, 0x21, 0x09, 0x20, 0x30, 
+	0x25, 0xc1, 0x25, 0xc0, 0x25, 0xb7, 0x25, 0xb6, 
+	0x26, 0x64, 0x26, 0x60, 0x26, 0x61, 0x26, 0x65, 
+	0x26, 0x67, 0x26, 0x63, 0x22, 0x99, 0x25, 0xc8, 
+	0x25, 0xa3, 0x25, 0xd0, 0x25, 0xd1, 0x25, 0x92, 
+	0x25, 0xa4, 0x25, 0xa5, 0x25, 0xa8, 0x25, 0xa7, 
+	0x25, 0xa6, 0x25, 0xa9, 0x26, 0x68, 0x26, 0x0f, 
+	0x26, 0x0e, 0x26, 0x1c, 0x26, 0x1e, 0x00, 0xb6, 
+	0x20, 0x20, 0x20, 0x21, 0x21, 0x95, 0x21, 0x97, 
+	0x21, 0x99, 0x21, 0x96, 0x21, 0x98, 0x26, 0x6d, 
+	0x26, 0x69, 0x26, 0x6a, 0x26, 0x6c, 0x32, 0x7f, 
+	0x32, 0x1c, 0x21, 0x16, 0x33, 0xc7, 0x21, 0x22, 
+	0x33, 0xc2, 0x33, 0xd8, 0x21, 0x21, 0x20, 0xac, 
+	0x00, 0xae, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0xff, 0x01, 0xff, 0x02, 0xff, 0x03, 0xff, 0x04, 
+	0xff, 0x05, 0xff, 0x06, 0xff, 0x07, 0xff, 0x08, 
+	0xff, 0x09, 0xff, 0x0a, 0xff, 0x0b, 0xff, 0x0c, 
+	0xff, 0x0d, 0xff, 0x0e, 0xff, 0x0f, 0xff, 0x10, 
+	0xff, 0x11, 0xff, 0x12, 0xff, 0x13, 0xff, 0x14, 
+	0xff, 0x15, 0xff, 0x16, 0xff, 0x17, 0xff, 0x18, 
+	0xff, 0x19, 0xff, 0x1a, 0xff, 0x1b, 0xff, 0x1c, 
+	0xff, 0x1d, 0xff, 0x1e, 0xff, 0x1f, 0xff, 0x20, 
+	0xff, 0x21, 0xff, 0x22, 0xff, 0x23, 0xff, 0x24, 
+	0xff, 0x25, 0xff, 0x26, 0xff, 0x27, 0xff, 0x28, 
+	0xff, 0x29, 0xff, 0x2a, 0xff, 0x2b, 0xff, 0x2c, 
+	0xff, 0x2d, 0xff, 0x2e, 0xff, 0x2f, 0xff, 0x30, 
+	0xff, 0x31, 0xff, 0x32, 0xff, 0x33, 0xff, 0x34, 
+	0xff, 0x35, 0xff, 0x36, 0xff, 0x37, 0xff, 0x38, 
+	0xff, 0x39, 0xff, 0x3a, 0xff, 0x3b, 0xff, 0xe6, 
+	0xff, 0x3d, 0xff, 0x3e, 0xff, 0x3f, 0xff, 0x40, 
+	0xff, 0x41, 0xff, 0x42, 0xff, 0x43, 0xff, 0x44, 
+	0xff, 0x45, 0xff, 0x46, 0xff, 0x47, 0xff, 0x48, 
+	0xff, 0x49, 0xff, 0x4a, 0xff, 0x4b, 0xff, 0x4c, 
+	0xff, 0x4d, 0xff, 0x4e, 0xff, 0x4f, 0xff, 0x50, 
+	0xff, 0x51, 0xff, 0x52, 0xff, 0x53, 0xff, 0x54, 
+	0xff, 0x55, 0xff, 0x56, 0xff, 0x57, 0xff, 0x58, 
+	0xff, 0x59, 0xff, 0x5a, 0xff, 0x5b, 0xff, 0x5c, 
+	0xff, 0x5d, 0xff, 0xe3, 0x31, 0x31, 0x31, 0x32, 
+	0x31, 0x33, 0x31, 0x34, 0x31, 0x35, 0x31, 0x36, 
+	0x31, 0x37, 0x31, 0x38, 0x31, 0x39, 0x31, 0x3a, 
+	0x31, 0x3b, 0x31, 0x3c, 0x31, 0x3d, 0x31, 0x3e, 
+	0x31, 0x3f, 0x31, 0x40, 0x31, 0x41, 0x31, 0x42, 
+	0x31, 0x43, 0x31, 0x44, 0x31, 0x45, 0x31, 0x46, 
+	0x31, 0x47, 0x31, 0x48, 0x31, 0x49, 0x31, 0x4a, 
+	0x31, 0x4b, 0x31, 0x4c, 0x31, 0x4d, 0x31, 0x4e, 
+	0x31, 0x4f, 0x31, 0x50, 0x31, 0x51, 0x31, 0x52, 
+	0x31, 0x53, 0x31, 0x54, 0x31, 0x55, 0x31, 0x56, 
+	0x31, 0x57, 0x31, 0x58, 0x31, 0x59, 0x31, 0x5a, 
+	0x31, 0x5b, 0x31, 0x5c, 0x31, 0x5d, 0x31, 0x5e, 
+	0x31, 0x5f, 0x31, 0x60, 0x31, 0x61, 0x31, 0x62, 
+	0x31, 0x63, 0x31, 0x64, 0x31, 0x65, 0x31, 0x66, 
+	0x31, 0x67, 0x31, 0x68, 0x31, 0x69, 0x31, 0x6a, 
+	0x31, 0x6b, 0x31, 0x6c, 0x31, 0x6d, 0x31, 0x6e, 
+	0x31, 0x6f, 0x31, 0x70, 0x31, 0x71, 0x31, 0x72, 
+	0x31, 0x73, 0x31, 0x74, 0x31, 0x75, 0x31, 0x76, 
+	0x31, 0x77, 0x31, 0x78, 0x31, 0x79, 0x31, 0x7a, 
+	0x31, 0x7b, 0x31, 0x7c, 0x31, 0x7d, 0x31, 0x7e, 
+	0x31, 0x7f, 0x31, 0x80, 0x31, 0x81, 0x31, 0x82, 
+	0x31, 0x83, 0x31, 0x84, 0x31, 0x85, 0x31, 0x86, 
+	0x31, 0x87, 0x31, 0x88, 0x31, 0x89, 0x31, 0x8a, 
+	0x31, 0x8b, 0x31, 0x8c, 0x31, 0x8d, 0x31, 0x8e, 
+	0x21, 0x70, 0x21, 0x71, 0x21, 0x72, 0x21, 0x73, 
+	0x21, 0x74, 0x21, 0x75, 0x21, 0x76, 0x21, 0x77, 
+	0x21, 0x78, 0x21, 0x79, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x21, 0x60, 
+	0x21, 0x61, 0x21, 0x62, 0x21, 0x63, 0x21, 0x64, 
+	0x21, 0x65, 0x21, 0x66, 0x21, 0x67, 0x21, 0x68, 
+	0x21, 0x69, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x03, 0x91, 0x03, 0x92, 0x03, 0x93, 0x03, 0x94, 
+	0x03, 0x95, 0x03, 0x96, 0x03, 0x97, 0x03, 0x98, 
+	0x03, 0x99, 0x03, 0x9a, 0x03, 0x9b, 0x03, 0x9c, 
+	0x03, 0x9d, 0x03, 0x9e, 0x03, 0x9f, 0x03, 0xa0, 
+	0x03, 0xa1, 0x03, 0xa3, 0x03, 0xa4, 0x03, 0xa5, 
+	0x03, 0xa6, 0x03, 0xa7, 0x03, 0xa8, 0x03, 0xa9, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x03, 0xb1, 0x03, 0xb2, 0x03, 0xb3, 0x03, 0xb4, 
+	0x03, 0xb5, 0x03, 0xb6, 0x03, 0xb7, 0x03, 0xb8, 
+	0x03, 0xb9, 0x03, 0xba, 0x03, 0xbb, 0x03, 0xbc, 
+	0x03, 0xbd, 0x03, 0xbe, 0x03, 0xbf, 0x03, 0xc0, 
+	0x03, 0xc1, 0x03, 0xc3, 0x03, 0xc4, 0x03, 0xc5, 
+	0x03, 0xc6, 0x03, 0xc7, 0x03, 0xc8, 0x03, 0xc9, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x25, 0x00, 0x25, 0x02, 
+	0x25, 0x0c, 0x25, 0x10, 0x25, 0x18, 0x25, 0x14, 
+	0x25, 0x1c, 0x25, 0x2c, 0x25, 0x24, 0x25, 0x34, 
+	0x25, 0x3c, 0x25, 0x01, 0x25, 0x03, 0x25, 0x0f, 
+	0x25, 0x13, 0x25, 0x1b, 0x25, 0x17, 0x25, 0x23, 
+	0x25, 0x33, 0x25, 0x2b, 0x25, 0x3b, 0x25, 0x4b, 
+	0x25, 0x20, 0x25, 0x2f, 0x25, 0x28, 0x25, 0x37, 
+	0x25, 0x3f, 0x25, 0x1d, 0x25, 0x30, 0x25, 0x25, 
+	0x25, 0x38, 0x25, 0x42, 0x25, 0x12, 0x25, 0x11, 
+	0x25, 0x1a, 0x25, 0x19, 0x25, 0x16, 0x25, 0x15, 
+	0x25, 0x0e, 0x25, 0x0d, 0x25, 0x1e, 0x25, 0x1f, 
+	0x25, 0x21, 0x25, 0x22, 0x25, 0x26, 0x25, 0x27, 
+	0x25, 0x29, 0x25, 0x2a, 0x25, 0x2d, 0x25, 0x2e, 
+	0x25, 0x31, 0x25, 0x32, 0x25, 0x35, 0x25, 0x36, 
+	0x25, 0x39, 0x25, 0x3a, 0x25, 0x3d, 0x25, 0x3e, 
+	0x25, 0x40, 0x25, 0x41, 0x25, 0x43, 0x25, 0x44, 
+	0x25, 0x45, 0x25, 0x46, 0x25, 0x47, 0x25, 0x48, 
+	0x25, 0x49, 0x25, 0x4a, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x33, 0x95, 0x33, 0x96, 0x33, 0x97, 0x21, 0x13, 
+	0x33, 0x98, 0x33, 0xc4, 0x33, 0xa3, 0x33, 0xa4, 
+	0x33, 0xa5, 0x33, 0xa6, 0x33, 0x99, 0x33, 0x9a, 
+	0x33, 0x9b, 0x33, 0x9c, 0x33, 0x9d, 0x33, 0x9e, 
+	0x33, 0x9f, 0x33, 0xa0, 0x33, 0xa1, 0x33, 0xa2, 
+	0x33, 0xca, 0x33, 0x8d, 0x33, 0x8e, 0x33, 0x8f, 
+	0x33, 0xcf, 0x33, 0x88, 0x33, 0x89, 0x33, 0xc8, 
+	0x33, 0xa7, 0x33, 0xa8, 0x33, 0xb0, 0x33, 0xb1, 
+	0x33, 0xb2, 0x33, 0xb3, 0x33, 0xb4, 0x33, 0xb5, 
+	0x33, 0xb6, 0x33, 0xb7, 0x33, 0xb8, 0x33, 0xb9, 
+	0x33, 0x80, 0x33, 0x81, 0x33, 0x82, 0x33, 0x83, 
+	0x33, 0x84, 0x33, 0xba, 0x33, 0xbb, 0x33, 0xbc, 
+	0x33, 0xbd, 0x33, 0xbe, 0x33, 0xbf, 0x33, 0x90, 
+	0x33, 0x91, 0x33, 0x92, 0x33, 0x93, 0x33, 0x94, 
+	0x21, 0x26, 0x33, 0xc0, 0x33, 0xc1, 0x33, 0x8a, 
+	0x33, 0x8b, 0x33, 0x8c, 0x33, 0xd6, 0x33, 0xc5, 
+	0x33, 0xad, 0x33, 0xae, 0x33, 0xaf, 0x33, 0xdb, 
+	0x33, 0xa9, 0x33, 0xaa, 0x33, 0xab, 0x33, 0xac, 
+	0x33, 0xdd, 0x33, 0xd0, 0x33, 0xd3, 0x33, 0xc3, 
+	0x33, 0xc9, 0x33, 0xdc, 0x33, 0xc6, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0xc6, 0x00, 0xd0, 
+	0x00, 0xaa, 0x01, 0x26, 0x00, 0x20, 0x01, 0x32, 
+	0x00, 0x20, 0x01, 0x3f, 0x01, 0x41, 0x00, 0xd8, 
+	0x01, 0x52, 0x00, 0xba, 0x00, 0xde, 0x01, 0x66, 
+	0x01, 0x4a, 0x00, 0x20, 0x32, 0x60, 0x32, 0x61, 
+	0x32, 0x62, 0x32, 0x63, 0x32, 0x64, 0x32, 0x65, 
+	0x32, 0x66, 0x32, 0x67, 0x32, 0x68, 0x32, 0x69, 
+	0x32, 0x6a, 0x32, 0x6b, 0x32, 0x6c, 0x32, 0x6d, 
+	0x32, 0x6e, 0x32, 0x6f, 0x32, 0x70, 0x32, 0x71, 
+	0x32, 0x72, 0x32, 0x73, 0x32, 0x74, 0x32, 0x75, 
+	0x32, 0x76, 0x32, 0x77, 0x32, 0x78, 0x32, 0x79, 
+	0x32, 0x7a, 0x32, 0x7b, 0x24, 0xd0, 0x24, 0xd1, 
+	0x24, 0xd2, 0x24, 0xd3, 0x24, 0xd4, 0x24, 0xd5, 
+	0x24, 0xd6, 0x24, 0xd7, 0x24, 0xd8, 0x24, 0xd9, 
+	0x24, 0xda, 0x24, 0xdb, 0x24, 0xdc, 0x24, 0xdd, 
+	0x24, 0xde, 0x24, 0xdf, 0x24, 0xe0, 0x24, 0xe1, 
+	0x24, 0xe2, 0x24, 0xe3, 0x24, 0xe4, 0x24, 0xe5, 
+	0x24, 0xe6, 0x24, 0xe7, 0x24, 0xe8, 0x24, 0xe9, 
+	0x24, 0x60, 0x24, 0x61, 0x24, 0x62, 0x24, 0x63, 
+	0x24, 0x64, 0x24, 0x65, 0x24, 0x66, 0x24, 0x67, 
+	0x24, 0x68, 0x24, 0x69, 0x24, 0x6a, 0x24, 0x6b, 
+	0x24, 0x6c, 0x24, 0x6d, 0x24, 0x6e, 0x00, 0xbd, 
+	0x21, 0x53, 0x21, 0x54, 0x00, 0xbc, 0x00, 0xbe, 
+	0x21, 0x5b, 0x21, 0x5c, 0x21, 0x5d, 0x21, 0x5e, 
+	0x00, 0xe6, 0x01, 0x11, 0x00, 0xf0, 0x01, 0x27, 
+	0x01, 0x31, 0x01, 0x33, 0x01, 0x38, 0x01, 0x40, 
+	0x01, 0x42, 0x00, 0xf8, 0x01, 0x53, 0x00, 0xdf, 
+	0x00, 0xfe, 0x01, 0x67, 0x01, 0x4b, 0x01, 0x49, 
+	0x32, 0x00, 0x32, 0x01, 0x32, 0x02, 0x32, 0x03, 
+	0x32, 0x04, 0x32, 0x05, 0x32, 0x06, 0x32, 0x07, 
+	0x32, 0x08, 0x32, 0x09, 0x32, 0x0a, 0x32, 0x0b, 
+	0x32, 0x0c, 0x32, 0x0d, 0x32, 0x0e, 0x32, 0x0f, 
+	0x32, 0x10, 0x32, 0x11, 0x32, 0x12, 0x32, 0x13, 
+	0x32, 0x14, 0x32, 0x15, 0x32, 0x16, 0x32, 0x17, 
+	0x32, 0x18, 0x32, 0x19, 0x32, 0x1a, 0x32, 0x1b, 
+	0x24, 0x9c, 0x24, 0x9d, 0x24, 0x9e, 0x24, 0x9f, 
+	0x24, 0xa0, 0x24, 0xa1, 0x24, 0xa2, 0x24, 0xa3, 
+	0x24, 0xa4, 0x24, 0xa5, 0x24, 0xa6, 0x24, 0xa7, 
+	0x24, 0xa8, 0x24, 0xa9, 0x24, 0xaa, 0x24, 0xab, 
+	0x24, 0xac, 0x24, 0xad, 0x24, 0xae, 0x24, 0xaf, 
+	0x24, 0xb0, 0x24, 0xb1, 0x24, 0xb2, 0x24, 0xb3, 
+	0x24, 0xb4, 0x24, 0xb5, 0x24, 0x74, 0x24, 0x75, 
+	0x24, 0x76, 0x24, 0x77, 0x24, 0x78, 0x24, 0x79, 
+	0x24, 0x7a, 0x24, 0x7b, 0x24, 0x7c, 0x24, 0x7d, 
+	0x24, 0x7e, 0x24, 0x7f, 0x24, 0x80, 0x24, 0x81, 
+	0x24, 0x82, 0x00, 0xb9, 0x00, 0xb2, 0x00, 0xb3, 
+	0x20, 0x74, 0x20, 0x7f, 0x20, 0x81, 0x20, 0x82, 
+	0x20, 0x83, 0x20, 0x84, 0x30, 0x41, 0x30, 0x42, 
+	0x30, 0x43, 0x30, 0x44, 0x30, 0x45, 0x30, 0x46, 
+	0x30, 0x47, 0x30, 0x48, 0x30, 0x49, 0x30, 0x4a, 
+	0x30, 0x4b, 0x30, 0x4c, 0x30, 0x4d, 0x30, 0x4e, 
+	0x30, 0x4f, 0x30, 0x50, 0x30, 0x51, 0x30, 0x52, 
+	0x30, 0x53, 0x30, 0x54, 0x30, 0x55, 0x30, 0x56, 
+	0x30, 0x57, 0x30, 0x58, 0x30, 0x59, 0x30, 0x5a, 
+	0x30, 0x5b, 0x30, 0x5c, 0x30, 0x5d, 0x30, 0x5e, 
+	0x30, 0x5f, 0x30, 0x60, 0x30, 0x61, 0x30, 0x62, 
+	0x30, 0x63, 0x30, 0x64, 0x30, 0x65, 0x30, 0x66, 
+	0x30, 0x67, 0x30, 0x68, 0x30, 0x69, 0x30, 0x6a, 
+	0x30, 0x6b, 0x30, 0x6c, 0x30, 0x6d, 0x30, 0x6e, 
+	0x30, 0x6f, 0x30, 0x70, 0x30, 0x71, 0x30, 0x72, 
+	0x30, 0x73, 0x30, 0x74, 0x30, 0x75, 0x30, 0x76, 
+	0x30, 0x77, 0x30, 0x78, 0x30, 0x79, 0x30, 0x7a, 
+	0x30, 0x7b, 0x30, 0x7c, 0x30, 0x7d, 0x30, 0x7e, 
+	0x30, 0x7f, 0x30, 0x80, 0x30, 0x81, 0x30, 0x82, 
+	0x30, 0x83, 0x30, 0x84, 0x30, 0x85, 0x30, 0x86, 
+	0x30, 0x87, 0x30, 0x88, 0x30, 0x89, 0x30, 0x8a, 
+	0x30, 0x8b, 0x30, 0x8c, 0x30, 0x8d, 0x30, 0x8e, 
+	0x30, 0x8f, 0x30, 0x90, 0x30, 0x91, 0x30, 0x92, 
+	0x30, 0x93, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x30, 0xa1, 0x30, 0xa2, 0x30, 0xa3, 0x30, 0xa4, 
+	0x30, 0xa5, 0x30, 0xa6, 0x30, 0xa7, 0x30, 0xa8, 
+	0x30, 0xa9, 0x30, 0xaa, 0x30, 0xab, 0x30, 0xac, 
+	0x30, 0xad, 0x30, 0xae, 0x30, 0xaf, 0x30, 0xb0, 
+	0x30, 0xb1, 0x30, 0xb2, 0x30, 0xb3, 0x30, 0xb4, 
+	0x30, 0xb5, 0x30, 0xb6, 0x30, 0xb7, 0x30, 0xb8, 
+	0x30, 0xb9, 0x30, 0xba, 0x30, 0xbb, 0x30, 0xbc, 
+	0x30, 0xbd, 0x30, 0xbe, 0x30, 0xbf, 0x30, 0xc0, 
+	0x30, 0xc1, 0x30, 0xc2, 0x30, 0xc3, 0x30, 0xc4, 
+	0x30, 0xc5, 0x30, 0xc6, 0x30, 0xc7, 0x30, 0xc8, 
+	0x30, 0xc9, 0x30, 0xca, 0x30, 0xcb, 0x30, 0xcc, 
+	0x30, 0xcd, 0x30, 0xce, 0x30, 0xcf, 0x30, 0xd0, 
+	0x30, 0xd1, 0x30, 0xd2, 0x30, 0xd3, 0x30, 0xd4, 
+	0x30, 0xd5, 0x30, 0xd6, 0x30, 0xd7, 0x30, 0xd8, 
+	0x30, 0xd9, 0x30, 0xda, 0x30, 0xdb, 0x30, 0xdc, 
+	0x30, 0xdd, 0x30, 0xde, 0x30, 0xdf, 0x30, 0xe0, 
+	0x30, 0xe1, 0x30, 0xe2, 0x30, 0xe3, 0x30, 0xe4, 
+	0x30, 0xe5, 0x30, 0xe6, 0x30, 0xe7, 0x30, 0xe8, 
+	0x30, 0xe9, 0x30, 0xea, 0x30, 0xeb, 0x30, 0xec, 
+	0x30, 0xed, 0x30, 0xee, 0x30, 0xef, 0x30, 0xf0, 
+	0x30, 0xf1, 0x30, 0xf2, 0x30, 0xf3, 0x30, 0xf4, 
+	0x30, 0xf5, 0x30, 0xf6, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x04, 0x10, 0x04, 0x11, 
+	0x04, 0x12, 0x04, 0x13, 0x04, 0x14, 0x04, 0x15, 
+	0x04, 0x01, 0x04, 0x16, 0x04, 0x17, 0x04, 0x18, 
+	0x04, 0x19, 0x04, 0x1a, 0x04, 0x1b, 0x04, 0x1c, 
+	0x04, 0x1d, 0x04, 0x1e, 0x04, 0x1f, 0x04, 0x20, 
+	0x04, 0x21, 0x04, 0x22, 0x04, 0x23, 0x04, 0x24, 
+	0x04, 0x25, 0x04, 0x26, 0x04, 0x27, 0x04, 0x28, 
+	0x04, 0x29, 0x04, 0x2a, 0x04, 0x2b, 0x04, 0x2c, 
+	0x04, 0x2d, 0x04, 0x2e, 0x04, 0x2f, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x04, 0x30, 0x04, 0x31, 
+	0x04, 0x32, 0x04, 0x33, 0x04, 0x34, 0x04, 0x35, 
+	0x04, 0x51, 0x04, 0x36, 0x04, 0x37, 0x04, 0x38, 
+	0x04, 0x39, 0x04, 0x3a, 0x04, 0x3b, 0x04, 0x3c, 
+	0x04, 0x3d, 0x04, 0x3e, 0x04, 0x3f, 0x04, 0x40, 
+	0x04, 0x41, 0x04, 0x42, 0x04, 0x43, 0x04, 0x44, 
+	0x04, 0x45, 0x04, 0x46, 0x04, 0x47, 0x04, 0x48, 
+	0x04, 0x49, 0x04, 0x4a, 0x04, 0x4b, 0x04, 0x4c, 
+	0x04, 0x4d, 0x04, 0x4e, 0x04, 0x4f, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 0x00, 0x20, 
+	0x4f, 0x3d, 0x4f, 0x73, 0x50, 0x47, 0x50, 0xf9, 
+	0x52, 0xa0, 0x53, 0xef, 0x54, 0x75, 0x54, 0xe5, 
+	0x56, 0x09, 0x5a, 0xc1, 0x5b, 0xb6, 0x66, 0x87, 
+	0x67, 0xb6, 0x67, 0xb7, 0x67, 0xef, 0x6b, 0x4c, 
+	0x73, 0xc2, 0x75, 0xc2, 0x7a, 0x3c, 0x82, 0xdb, 
+	0x83, 0x04, 0x88, 0x57, 0x88, 0x88, 0x8a, 0x36, 
+	0x8c, 0xc8, 0x8d, 0xcf, 0x8e, 0xfb, 0x8f, 0xe6, 
+	0x99, 0xd5, 0x52, 0x3b, 0x53, 0x74, 0x54, 0x04, 
+	0x60, 0x6a, 0x61, 0x64, 0x6b, 0xbc, 0x73, 0xcf, 
+	0x81, 0x1a, 0x89, 0xba, 0x89, 0xd2, 0x95, 0xa3, 
+	0x4f, 0x83, 0x52, 0x0a, 0x58, 0xbe, 0x59, 0x78, 
+	0x59, 0xe6, 0x5e, 0x72, 0x5e, 0x79, 0x61, 0xc7, 
+	0x63, 0xc0, 0x67, 0x46, 0x67, 0xec, 0x68, 0x7f, 
+	0x6f, 0x97, 0x76, 0x4e, 0x77, 0x0b, 0x78, 0xf5, 
+	0x7a, 0x08, 0x7a, 0xff, 0x7c, 0x21, 0x80, 0x9d, 
+	0x82, 0x6e, 0x82, 0x71, 0x8a, 0xeb, 0x95, 0x93, 
+	0x4e, 0x6b, 0x55, 0x9d, 0x66, 0xf7, 0x6e, 0x34, 
+	0x78, 0xa3, 0x7a, 0xed, 0x84, 0x5b, 0x89, 0x10, 
+	0x87, 0x4e, 0x97, 0xa8, 0x52, 0xd8, 0x57, 0x4e, 
+	0x58, 0x2a, 0x5d, 0x4c, 0x61, 0x1f, 0x61, 0xbe, 
+	0x62, 0x21, 0x65, 0x62, 0x67, 0xd1, 0x6a, 0x44, 
+	0x6e, 0x1b, 0x75, 0x18, 0x75, 0xb3, 0x76, 0xe3, 
+	0x77, 0xb0, 0x7d, 0x3a, 0x90, 0xaf, 0x94, 0x51, 
+	0x94, 0x52, 0x9f, 0x95, 0x53, 0x23, 0x5c, 0xac, 
+	0x75, 0x32, 0x80, 0xdb, 0x92, 0x40, 0x95, 0x98, 
+	0x52, 0x5b, 0x58, 0x08, 0x59, 0xdc, 0x5c, 0xa1, 
+	0x5d, 0x17, 0x5e, 0xb7, 0x5f, 0x3a, 0x5f, 0x4a, 
+	0x61, 0x77, 0x6c, 0x5f, 0x75, 0x7a, 0x75, 0x86, 
+	0x7c, 0xe0, 0x7d, 0x73, 0x7d, 0xb1, 0x7f, 0x8c, 
+	0x81, 0x54, 0x82, 0x21, 0x85, 0x91, 0x89, 0x41, 
+	0x8b, 0x1b, 0x92, 0xfc, 0x96, 0x4d, 0x9c, 0x47, 
+	0x4e, 0xcb, 0x4e, 0xf7, 0x50, 0x0b, 0x51, 0xf1, 
+	0x58, 0x4f, 0x61, 0x37, 0x61, 0x3e, 0x61, 0x68, 
+	0x65, 0x39, 0x69, 0xea, 0x6f, 0x11, 0x75, 0xa5, 
+	0x76, 0x86, 0x76, 0xd6, 0x7b, 0x87, 0x82, 0xa5, 
+	0x84, 0xcb, 0xf9, 0x00, 0x93, 0xa7, 0x95, 0x8b, 
+	0x55, 0x80, 0x5b, 0xa2, 0x57, 0x51, 0xf9, 0x01, 
+	0x7c, 0xb3, 0x7f, 0xb9, 0x91, 0xb5, 0x50, 0x28, 
+	0x53, 0xbb, 0x5c, 0x45, 0x5d, 0xe8, 0x62, 0xd2, 
+	0x63, 0x6e, 0x64, 0xda, 0x64, 0xe7, 0x6e, 0x20, 
+	0x70, 0xac, 0x79, 0x5b, 0x8d, 0xdd, 0x8e, 0x1e, 
+	0xf9, 0x02, 0x90, 0x7d, 0x92, 0x45, 0x92, 0xf8, 
+	0x4e, 0x7e, 0x4e, 0xf6, 0x50, 0x65, 0x5d, 0xfe, 
+	0x5e, 0xfa, 0x61, 0x06, 0x69, 0x57, 0x81, 0x71, 
+	0x86, 0x54, 0x8e, 0x47, 0x93, 0x75, 0x9a, 0x2b, 
+	0x4e, 0x5e, 0x50, 0x91, 0x67, 0x70, 0x68, 0x40, 
+	0x51, 0x09, 0x52, 0x8d, 0x52, 0x92, 0x6a, 0xa2, 
+	0x77, 0xbc, 0x92, 0x10, 0x9e, 0xd4, 0x52, 0xab, 
+	0x60, 0x2f, 0x8f, 0xf2, 0x50, 0x48, 0x61, 0xa9, 
+	0x63, 0xed, 0x64, 0xca, 0x68, 0x3c, 0x6a, 0x84, 
+	0x6f, 0xc0, 0x81, 0x88, 0x89, 0xa1, 0x96, 0x94, 
+	0x58, 0x05, 0x72, 0x7d, 0x72, 0xac, 0x75, 0x04, 
+	0x7d, 0x79, 0x7e, 0x6d, 0x80, 0xa9, 0x89, 0x8b, 
+	0x8b, 0x74, 0x90, 0x63, 0x9d, 0x51, 0x62, 0x89, 
+	0x6c, 0x7a, 0x6f, 0x54, 0x7d, 0x50, 0x7f, 0x3a, 
+	0x8a, 0x23, 0x51, 0x7c, 0x61, 0x4a, 0x7b, 0x9d, 
+	0x8b, 0x19, 0x92, 0x57, 0x93, 0x8c, 0x4e, 0xac, 
+	0x4f, 0xd3, 0x50, 0x1e, 0x50, 0xbe, 0x51, 0x06, 
+	0x52, 0xc1, 0x52, 0xcd, 0x53, 0x7f, 0x57, 0x70, 
+	0x58, 0x83, 0x5e, 0x9a, 0x5f, 0x91, 0x61, 0x76, 
+	0x61, 0xac, 0x64, 0xce, 0x65, 0x6c, 0x66, 0x6f, 
+	0x66, 0xbb, 0x66, 0xf4, 0x68, 0x97, 0x6d, 0x87, 
+	0x70, 0x85, 0x70, 0xf1, 0x74, 0x9f, 0x74, 0xa5, 
+	0x74, 0xca, 0x75, 0xd9, 0x78, 0x6c, 0x78, 0xec, 
+	0x7a, 0xdf, 0x7a, 0xf6, 0x7d, 0x45, 0x7d, 0x93, 
+	0x80, 0x15, 0x80, 0x3f, 0x81, 0x1b, 0x83, 0x96, 
+	0x8b, 0x66, 0x8f, 0x15, 0x90, 0x15, 0x93, 0xe1, 
+	0x98, 0x03, 0x98, 0x38, 0x9a, 0x5a, 0x9b, 0xe8, 
+	0x4f, 0xc2, 0x55, 0x53, 0x58, 0x3a, 0x59, 0x51, 
+	0x5b, 0x63, 0x5c, 0x46, 0x60, 0xb8, 0x62, 0x12, 
+	0x68, 0x42, 0x68, 0xb0, 0x68, 0xe8, 0x6e, 0xaa, 
+	0x75, 0x4c, 0x76, 0x78, 0x78, 0xce, 0x7a, 0x3d, 
+	0x7c, 0xfb, 0x7e, 0x6b, 0x7e, 0x7c, 0x8a, 0x08, 
+	0x8a, 0xa1, 0x8c, 0x3f, 0x96, 0x8e, 0x9d, 0xc4, 
+	0x53, 0xe4, 0x53, 0xe9, 0x54, 0x4a, 0x54, 0x71, 
+	0x56, 0xfa, 0x59, 0xd1, 0x5b, 0x64, 0x5c, 0x3b, 
+	0x5e, 0xab, 0x62, 0xf7, 0x65, 0x37, 0x65, 0x45, 
+	0x65, 0x72, 0x66, 0xa0, 0x67, 0xaf, 0x69, 0xc1, 
+	0x6c, 0xbd, 0x75, 0xfc, 0x76, 0x90, 0x77, 0x7e, 
+	0x7a, 0x3f, 0x7f, 0x94, 0x80, 0x03, 0x80, 0xa1, 
+	0x81, 0x8f, 0x82, 0xe6, 0x82, 0xfd, 0x83, 0xf0, 
+	0x85, 0xc1, 0x88, 0x31, 0x88, 0xb4, 0x8a, 0xa5, 
+	0xf9, 0x03, 0x8f, 0x9c, 0x93, 0x2e, 0x96, 0xc7, 
+	0x98, 0x67, 0x9a, 0xd8, 0x9f, 0x13, 0x54, 0xed, 
+	0x65, 0x9b, 0x66, 0xf2, 0x68, 0x8f, 0x7a, 0x40, 
+	0x8c, 0x37, 0x9d, 0x60, 0x56, 0xf0, 0x57, 0x64, 
+	0x5d, 0x11, 0x66, 0x06, 0x68, 0xb1, 0x68, 0xcd, 
+	0x6e, 0xfe, 0x74, 0x28, 0x88, 0x9e, 0x9b, 0xe4, 
+	0x6c, 0x68, 0xf9, 0x04, 0x9a, 0xa8, 0x4f, 0x9b, 
+	0x51, 0x6c, 0x51, 0x71, 0x52, 0x9f, 0x5b, 0x54, 
+	0x5d, 0xe5, 0x60, 0x50, 0x60, 0x6d, 0x62, 0xf1, 
+	0x63, 0xa7, 0x65, 0x3b, 0x73, 0xd9, 0x7a, 0x7a, 
+	0x86, 0xa3, 0x8c, 0xa2, 0x97, 0x8f, 0x4e, 0x32, 
+	0x5b, 0xe1, 0x62, 0x08, 0x67, 0x9c, 0x74, 0xdc, 
+	0x79, 0xd1, 0x83, 0xd3, 0x8a, 0x87, 0x8a, 0xb2, 
+	0x8d, 0xe8, 0x90, 0x4e, 0x93, 0x4b, 0x98, 0x46, 
+	0x5e, 0xd3, 0x69, 0xe8, 0x85, 0xff, 0x90, 0xed, 
+	0xf9, 0x05, 0x51, 0xa0, 0x5b, 0x98, 0x5b, 0xec, 
+	0x61, 0x63, 0x68, 0xfa, 0x6b, 0x3e, 0x70, 0x4c, 
+	0x74, 0x2f, 0x74, 0xd8, 0x7b, 0xa1, 0x7f, 0x50, 
+	0x83, 0xc5, 0x89, 0xc0, 0x8c, 0xab, 0x95, 0xdc, 
+	0x99, 0x28, 0x52, 0x2e, 0x60, 0x5d, 0x62, 0xec, 
+	0x90, 0x02, 0x4f, 0x8a, 0x51, 0x49, 0x53, 0x21, 
+	0x58, 0xd9, 0x5e, 0xe3, 0x66, 0xe0, 0x6d, 0x38, 
+	0x70, 0x9a, 0x72, 0xc2, 0x73, 0xd6, 0x7b, 0x50, 
+	0x80, 0xf1, 0x94, 0x5b, 0x53, 0x66, 0x63, 0x9b, 
+	0x7f, 0x6b, 0x4e, 0x56, 0x50, 0x80, 0x58, 0x4a, 
+	0x58, 0xde, 0x60, 0x2a, 0x61, 0x27, 0x62, 0xd0, 
+	0x69, 0xd0, 0x9b, 0x41, 0x5b, 0x8f, 0x7d, 0x18, 
+	0x80, 0xb1, 0x8f, 0x5f, 0x4e, 0xa4, 0x50, 0xd1, 
+	0x54, 0xac, 0x55, 0xac, 0x5b, 0x0c, 0x5d, 0xa0, 
+	0x5d, 0xe7, 0x65, 0x2a, 0x65, 0x4e, 0x68, 0x21, 
+	0x6a, 0x4b, 0x72, 0xe1, 0x76, 0x8e, 0x77, 0xef, 
+	0x7d, 0x5e, 0x7f, 0xf9, 0x81, 0xa0, 0x85, 0x4e, 
+	0x86, 0xdf, 0x8f, 0x03, 0x8f, 0x4e, 0x90, 0xca, 
+	0x99, 0x03, 0x9a, 0x55, 0x9b, 0xab, 0x4e, 0x18, 
+	0x4e, 0x45, 0x4e, 0x5d, 0x4e, 0xc7, 0x4f, 0xf1, 
+	0x51, 0x77, 0x52, 0xfe, 0x53, 0x40, 0x53, 0xe3, 
+	0x53, 0xe5, 0x54, 0x8e, 0x56, 0x14, 0x57, 0x75, 
+	0x57, 0xa2, 0x5b, 0xc7, 0x5d, 0x87, 0x5e, 0xd0, 
+	0x61, 0xfc, 0x62, 0xd8, 0x65, 0x51, 0x67, 0xb8, 
+	0x67, 0xe9, 0x69, 0xcb, 0x6b, 0x50, 0x6b, 0xc6, 
+	0x6b, 0xec, 0x6c, 0x42, 0x6e, 0x9d, 0x70, 0x78, 
+	0x72, 0xd7, 0x73, 0x96, 0x74, 0x03, 0x77, 0xbf, 
+	0x77, 0xe9, 0x7a, 0x76, 0x7d, 0x7f, 0x80, 0x09, 
+	0x81, 0xfc, 0x82, 0x05, 0x82, 0x0a, 0x82, 0xdf, 
+	0x88, 0x62, 0x8b, 0x33, 0x8c, 0xfc, 0x8e, 0xc0, 
+	0x90, 0x11, 0x90, 0xb1, 0x92, 0x64, 0x92, 0xb6, 
+	0x99, 0xd2, 0x9a, 0x45, 0x9c, 0xe9, 0x9d, 0xd7, 
+	0x9f, 0x9c, 0x57, 0x0b, 0x5c, 0x40, 0x83, 0xca, 
+	0x97, 0xa0, 0x97, 0xab, 0x9e, 0xb4, 0x54, 0x1b, 
+	0x7a, 0x98, 0x7f, 0xa4, 0x88, 0xd9, 0x8e, 0xcd, 
+	0x90, 0xe1, 0x58, 0x00, 0x5c, 0x48, 0x63, 0x98, 
+	0x7a, 0x9f, 0x5b, 0xae, 0x5f, 0x13, 0x7a, 0x79, 
+	0x7a, 0xae, 0x82, 0x8e, 0x8e, 0xac, 0x50, 0x26, 
+	0x52, 0x38, 0x52, 0xf8, 0x53, 0x77, 0x57, 0x08, 
+	0x62, 0xf3, 0x63, 0x72, 0x6b, 0x0a, 0x6d, 0xc3, 
+	0x77, 0x37, 0x53, 0xa5, 0x73, 0x57, 0x85, 0x68, 
+	0x8e, 0x76, 0x95, 0xd5, 0x67, 0x3a, 0x6a, 0xc3, 
+	0x6f, 0x70, 0x8a, 0x6d, 0x8e, 0xcc, 0x99, 0x4b, 
+	0xf9, 0x06, 0x66, 0x77, 0x6b, 0x78, 0x8c, 0xb4, 
+	0x9b, 0x3c, 0xf9, 0x07, 0x53, 0xeb, 0x57, 0x2d, 
+	0x59, 0x4e, 0x63, 0xc6, 0x69, 0xfb, 0x73, 0xea, 
+	0x78, 0x45, 0x7a, 0xba, 0x7a, 0xc5, 0x7c, 0xfe, 
+	0x84, 0x75, 0x89, 0x8f, 0x8d, 0x73, 0x90, 0x35, 
+	0x95, 0xa8, 0x52, 0xfb, 0x57, 0x47, 0x75, 0x47, 
+	0x7b, 0x60, 0x83, 0xcc, 0x92, 0x1e, 0xf9, 0x08, 
+	0x6a, 0x58, 0x51, 0x4b, 0x52, 0x4b, 0x52, 0x87, 
+	0x62, 0x1f, 0x68, 0xd8, 0x69, 0x75, 0x96, 0x99, 
+	0x50, 0xc5, 0x52, 0xa4, 0x52, 0xe4, 0x61, 0xc3, 
+	0x65, 0xa4, 0x68, 0x39, 0x69, 0xff, 0x74, 0x7e, 
+	0x7b, 0x4b, 0x82, 0xb9, 0x83, 0xeb, 0x89, 0xb2, 
+	0x8b, 0x39, 0x8f, 0xd1, 0x99, 0x49, 0xf9, 0x09, 
+	0x4e, 0xca, 0x59, 0x97, 0x64, 0xd2, 0x66, 0x11, 
+	0x6a, 0x8e, 0x74, 0x34, 0x79, 0x81, 0x79, 0xbd, 
+	0x82, 0xa9, 0x88, 0x7e, 0x88, 0x7f, 0x89, 0x5f, 
+	0xf9, 0x0a, 0x93, 0x26, 0x4f, 0x0b, 0x53, 0xca, 
+	0x60, 0x25, 0x62, 0x71, 0x6c, 0x72, 0x7d, 0x1a, 
+	0x7d, 0x66, 0x4e, 0x98, 0x51, 0x62, 0x77, 0xdc, 
+	0x80, 0xaf, 0x4f, 0x01, 0x4f, 0x0e, 0x51, 0x76, 
+	0x51, 0x80, 0x55, 0xdc, 0x56, 0x68, 0x57, 0x3b, 
+	0x57, 0xfa, 0x57, 0xfc, 0x59, 0x14, 0x59, 0x47, 
+	0x59, 0x93, 0x5b, 0xc4, 0x5c, 0x90, 0x5d, 0x0e, 
+	0x5d, 0xf1, 0x5e, 0x7e, 0x5f, 0xcc, 0x62, 0x80, 
+	0x65, 0xd7, 0x65, 0xe3, 0x67, 0x1e, 0x67, 0x1f, 
+	0x67, 0x5e, 0x68, 0xcb, 0x68, 0xc4, 0x6a, 0x5f, 
+	0x6b, 0x3a, 0x6c, 0x23, 0x6c, 0x7d, 0x6c, 0x82, 
+	0x6d, 0xc7, 0x73, 0x98, 0x74, 0x26, 0x74, 0x2a, 
+	0x74, 0x82, 0x74, 0xa3, 0x75, 0x78, 0x75, 0x7f, 
+	0x78, 0x81, 0x78, 0xef, 0x79, 0x41, 0x79, 0x47, 
+	0x79, 0x48, 0x79, 0x7a, 0x7b, 0x95, 0x7d, 0x00, 
+	0x7d, 0xba, 0x7f, 0x88, 0x80, 0x06, 0x80, 0x2d, 
+	0x80, 0x8c, 0x8a, 0x18, 0x8b, 0x4f, 0x8c, 0x48, 
+	0x8d, 0x77, 0x93, 0x21, 0x93, 0x24, 0x98, 0xe2, 
+	0x99, 0x51, 0x9a, 0x0e, 0x9a, 0x0f, 0x9a, 0x65, 
+	0x9e, 0x92, 0x7d, 0xca, 0x4f, 0x76, 0x54, 0x09, 
+	0x62, 0xee, 0x68, 0x54, 0x91, 0xd1, 0x55, 0xab, 
+	0x51, 0x3a, 0xf9, 0x0b, 0xf9, 0x0c, 0x5a, 0x1c, 
+	0x61, 0xe6, 0xf9, 0x0d, 0x62, 0xcf, 0x62, 0xff, 
+	0xf9, 0x0e, 0xf9, 0x0f, 0xf9, 0x10, 0xf9, 0x11, 
+	0xf9, 0x12, 0xf9, 0x13, 0x90, 0xa3, 0xf9, 0x14, 
+	0xf9, 0x15, 0xf9, 0x16, 0xf9, 0x17, 0xf9, 0x18, 
+	0x8a, 0xfe, 0xf9, 0x19, 0xf9, 0x1a, 0xf9, 0x1b, 
+	0xf9, 0x1c, 0x66, 0x96, 0xf9, 0x1d, 0x71, 0x56, 
+	0xf9, 0x1e, 0xf9, 0x1f, 0x96, 0xe3, 0xf9, 0x20, 
+	0x63, 0x4f, 0x63, 0x7a, 0x53, 0x57, 0xf9, 0x21, 
+	0x67, 0x8f, 0x69, 0x60, 0x6e, 0x73, 0xf9, 0x22, 
+	0x75, 0x37, 0xf9, 0x23, 0xf9, 0x24, 0xf9, 0x25, 
+	0x7d, 0x0d, 0xf9, 0x26, 0xf9, 0x27, 0x88, 0x72, 
+	0x56, 0xca, 0x5a, 0x18, 0xf9, 0x28, 0xf9, 0x29, 
+	0xf9, 0x2a, 0xf9, 0x2b, 0xf9, 0x2c, 0x4e, 0x43, 
+	0xf9, 0x2d, 0x51, 0x67, 0x59, 0x48, 0x67, 0xf0, 
+	0x80, 0x10, 0xf9, 0x2e, 0x59, 0x73, 0x5e, 0x74, 
+	0x64, 0x9a, 0x79, 0xca, 0x5f, 0xf5, 0x60, 0x6c, 
+	0x62, 0xc8, 0x63, 0x7b, 0x5b, 0xe7, 0x5b, 0xd7, 
+	0x52, 0xaa, 0xf9, 0x2f, 0x59, 0x74, 0x5f, 0x29, 
+	0x60, 0x12, 0xf9, 0x30, 0xf9, 0x31, 0xf9, 0x32, 
+	0x74, 0x59, 0xf9, 0x33, 0xf9, 0x34, 0xf9, 0x35, 
+	0xf9, 0x36, 0xf9, 0x37, 0xf9, 0x38, 0x99, 0xd1, 
+	0xf9, 0x39, 0xf9, 0x3a, 0xf9, 0x3b, 0xf9, 0x3c, 
+	0xf9, 0x3d, 0xf9, 0x3e, 0xf9, 0x3f, 0xf9, 0x40, 
+	0xf9, 0x41, 0xf9, 0x42, 0xf9, 0x43, 0x6f, 0xc3, 
+	0xf9, 0x44, 0xf9, 0x45, 0x81, 0xbf, 0x8f, 0xb2, 
+	0x60, 0xf1, 0xf9, 0x46, 0xf9, 0x47, 0x81, 0x66, 
+	0xf9, 0x48, 0xf9, 0x49, 0x5c, 0x3f, 0xf9, 0x4a, 
+	0xf9, 0x4b, 0xf9, 0x4c, 0xf9, 0x4d, 0xf9, 0x4e, 
+	0xf9, 0x4f, 0xf9, 0x50, 0xf9, 0x51, 0x5a, 0xe9, 
+	0x8a, 0x25, 0x67, 0x7b, 0x7d, 0x10, 0xf9, 0x52, 
+	0xf9, 0x53, 0xf9, 0x54, 0xf9, 0x55, 0xf9, 0x56, 
+	0xf9, 0x57, 0x80, 0xfd, 0xf9, 0x58, 0xf9, 0x59, 
+	0x5c, 0x3c, 0x6c, 0xe5, 0x53, 0x3f, 0x6e, 0xba, 
+	0x59, 0x1a, 0x83, 0x36, 0x4e, 0x39, 0x4e, 0xb6, 
+	0x4f, 0x46, 0x55, 0xae, 0x57, 0x18, 0x58, 0xc7, 
+	0x5f, 0x56, 0x65, 0xb7, 0x65, 0xe6, 0x6a, 0x80, 
+	0x6b, 0xb5, 0x6e, 0x4d, 0x77, 0xed, 0x7a, 0xef, 
+	0x7c, 0x1e, 0x7d, 0xde, 0x86, 0xcb, 0x88, 0x92, 
+	0x91, 0x32, 0x93, 0x5b, 0x64, 0xbb, 0x6f, 0xbe, 
+	0x73, 0x7a, 0x75, 0xb8, 0x90, 0x54, 0x55, 0x56, 
+	0x57, 0x4d, 0x61, 0xba, 0x64, 0xd4, 0x66, 0xc7, 
+	0x6d, 0xe1, 0x6e, 0x5b, 0x6f, 0x6d, 0x6f, 0xb9, 
+	0x75, 0xf0, 0x80, 0x43, 0x81, 0xbd, 0x85, 0x41, 
+	0x89, 0x83, 0x8a, 0xc7, 0x8b, 0x5a, 0x93, 0x1f, 
+	0x6c, 0x93, 0x75, 0x53, 0x7b, 0x54, 0x8e, 0x0f, 
+	0x90, 0x5d, 0x55, 0x10, 0x58, 0x02, 0x58, 0x58, 
+	0x5e, 0x62, 0x62, 0x07, 0x64, 0x9e, 0x68, 0xe0, 
+	0x75, 0x76, 0x7c, 0xd6, 0x87, 0xb3, 0x9e, 0xe8, 
+	0x4e, 0xe3, 0x57, 0x88, 0x57, 0x6e, 0x59, 0x27, 
+	0x5c, 0x0d, 0x5c, 0xb1, 0x5e, 0x36, 0x5f, 0x85, 
+	0x62, 0x34, 0x64, 0xe1, 0x73, 0xb3, 0x81, 0xfa, 
+	0x88, 0x8b, 0x8c, 0xb8, 0x96, 0x8a, 0x9e, 0xdb, 
+	0x5b, 0x85, 0x5f, 0xb7, 0x60, 0xb3, 0x50, 0x12, 
+	0x52, 0x00, 0x52, 0x30, 0x57, 0x16, 0x58, 0x35, 
+	0x58, 0x57, 0x5c, 0x0e, 0x5c, 0x60, 0x5c, 0xf6, 
+	0x5d, 0x8b, 0x5e, 0xa6, 0x5f, 0x92, 0x60, 0xbc, 
+	0x63, 0x11, 0x63, 0x89, 0x64, 0x17, 0x68, 0x43, 
+	0x68, 0xf9, 0x6a, 0xc2, 0x6d, 0xd8, 0x6e, 0x21, 
+	0x6e, 0xd4, 0x6f, 0xe4, 0x71, 0xfe, 0x76, 0xdc, 
+	0x77, 0x79, 0x79, 0xb1, 0x7a, 0x3b, 0x84, 0x04, 
+	0x89, 0xa9, 0x8c, 0xed, 0x8d, 0xf3, 0x8e, 0x48, 
+	0x90, 0x03, 0x90, 0x14, 0x90, 0x53, 0x90, 0xfd, 
+	0x93, 0x4d, 0x96, 0x76, 0x97, 0xdc, 0x6b, 0xd2, 
+	0x70, 0x06, 0x72, 0x58, 0x72, 0xa2, 0x73, 0x68, 
+	0x77, 0x63, 0x79, 0xbf, 0x7b, 0xe4, 0x7e, 0x9b, 
+	0x8b, 0x80, 0x58, 0xa9, 0x60, 0xc7, 0x65, 0x66, 
+	0x65, 0xfd, 0x66, 0xbe, 0x6c, 0x8c, 0x71, 0x1e, 
+	0x71, 0xc9, 0x8c, 0x5a, 0x98, 0x13, 0x4e, 0x6d, 
+	0x7a, 0x81, 0x4e, 0xdd, 0x51, 0xac, 0x51, 0xcd, 
+	0x52, 0xd5, 0x54, 0x0c, 0x61, 0xa7, 0x67, 0x71, 
+	0x68, 0x50, 0x68, 0xdf, 0x6d, 0x1e, 0x6f, 0x7c, 
+	0x75, 0xbc, 0x77, 0xb3, 0x7a, 0xe5, 0x80, 0xf4, 
+	0x84, 0x63, 0x92, 0x85, 0x51, 0x5c, 0x65, 0x97, 
+	0x67, 0x5c, 0x67, 0x93, 0x75, 0xd8, 0x7a, 0xc7, 
+	0x83, 0x73, 0xf9, 0x5a, 0x8c, 0x46, 0x90, 0x17, 
+	0x98, 0x2d, 0x5c, 0x6f, 0x81, 0xc0, 0x82, 0x9a, 
+	0x90, 0x41, 0x90, 0x6f, 0x92, 0x0d, 0x5f, 0x97, 
+	0x5d, 0x9d, 0x6a, 0x59, 0x71, 0xc8, 0x76, 0x7b, 
+	0x7b, 0x49, 0x85, 0xe4, 0x8b, 0x04, 0x91, 0x27, 
+	0x9a, 0x30, 0x55, 0x87, 0x61, 0xf6, 0xf9, 0x5b, 
+	0x76, 0x69, 0x7f, 0x85, 0x86, 0x3f, 0x87, 0xba, 
+	0x88, 0xf8, 0x90, 0x8f, 0xf9, 0x5c, 0x6d, 0x1b, 
+	0x70, 0xd9, 0x73, 0xde, 0x7d, 0x61, 0x84, 0x3d, 
+	0xf9, 0x5d, 0x91, 0x6a, 0x99, 0xf1, 0xf9, 0x5e, 
+	0x4e, 0x82, 0x53, 0x75, 0x6b, 0x04, 0x6b, 0x12, 
+	0x70, 0x3e, 0x72, 0x1b, 0x86, 0x2d, 0x9e, 0x1e, 
+	0x52, 0x4c, 0x8f, 0xa3, 0x5d, 0x50, 0x64, 0xe5, 
+	0x65, 0x2c, 0x6b, 0x16, 0x6f, 0xeb, 0x7c, 0x43, 
+	0x7e, 0x9c, 0x85, 0xcd, 0x89, 0x64, 0x89, 0xbd, 
+	0x62, 0xc9, 0x81, 0xd8, 0x88, 0x1f, 0x5e, 0xca, 
+	0x67, 0x17, 0x6d, 0x6a, 0x72, 0xfc, 0x74, 0x05, 
+	0x74, 0x6f, 0x87, 0x82, 0x90, 0xde, 0x4f, 0x86, 
+	0x5d, 0x0d, 0x5f, 0xa0, 0x84, 0x0a, 0x51, 0xb7, 
+	0x63, 0xa0, 0x75, 0x65, 0x4e, 0xae, 0x50, 0x06, 
+	0x51, 0x69, 0x51, 0xc9, 0x68, 0x81, 0x6a, 0x11, 
+	0x7c, 0xae, 0x7c, 0xb1, 0x7c, 0xe7, 0x82, 0x6f, 
+	0x8a, 0xd2, 0x8f, 0x1b, 0x91, 0xcf, 0x4f, 0xb6, 
+	0x51, 0x37, 0x52, 0xf5, 0x54, 0x42, 0x5e, 0xec, 
+	0x61, 0x6e, 0x62, 0x3e, 0x65, 0xc5, 0x6a, 0xda, 
+	0x6f, 0xfe, 0x79, 0x2a, 0x85, 0xdc, 0x88, 0x23, 
+	0x95, 0xad, 0x9a, 0x62, 0x9a, 0x6a, 0x9e, 0x97, 
+	0x9e, 0xce, 0x52, 0x9b, 0x66, 0xc6, 0x6b, 0x77, 
+	0x70, 0x1d, 0x79, 0x2b, 0x8f, 0x62, 0x97, 0x42, 
+	0x61, 0x90, 0x62, 0x00, 0x65, 0x23, 0x6f, 0x23, 
+	0x71, 0x49, 0x74, 0x89, 0x7d, 0xf4, 0x80, 0x6f, 
+	0x84, 0xee, 0x8f, 0x26, 0x90, 0x23, 0x93, 0x4a, 
+	0x51, 0xbd, 0x52, 0x17, 0x52, 0xa3, 0x6d, 0x0c, 
+	0x70, 0xc8, 0x88, 0xc2, 0x5e, 0xc9, 0x65, 0x82, 
+	0x6b, 0xae, 0x6f, 0xc2, 0x7c, 0x3e, 0x73, 0x75, 
+	0x4e, 0xe4, 0x4f, 0x36, 0x56, 0xf9, 0xf9, 0x5f, 
+	0x5c, 0xba, 0x5d, 0xba, 0x60, 0x1c, 0x73, 0xb2, 
+	0x7b, 0x2d, 0x7f, 0x9a, 0x7f, 0xce, 0x80, 0x46, 
+	0x90, 0x1e, 0x92, 0x34, 0x96, 0xf6, 0x97, 0x48, 
+	0x98, 0x18, 0x9f, 0x61, 0x4f, 0x8b, 0x6f, 0xa7, 
+	0x79, 0xae, 0x91, 0xb4, 0x96, 0xb7, 0x52, 0xde, 
+	0xf9, 0x60, 0x64, 0x88, 0x64, 0xc4, 0x6a, 0xd3, 
+	0x6f, 0x5e, 0x70, 0x18, 0x72, 0x10, 0x76, 0xe7, 
+	0x80, 0x01, 0x86, 0x06, 0x86, 0x5c, 0x8d, 0xef, 
+	0x8f, 0x05, 0x97, 0x32, 0x9b, 0x6f, 0x9d, 0xfa, 
+	0x9e, 0x75, 0x78, 0x8c, 0x79, 0x7f, 0x7d, 0xa0, 
+	0x83, 0xc9, 0x93, 0x04, 0x9e, 0x7f, 0x9e, 0x93, 
+	0x8a, 0xd6, 0x58, 0xdf, 0x5f, 0x04, 0x67, 0x27, 
+	0x70, 0x27, 0x74, 0xcf, 0x7c, 0x60, 0x80, 0x7e, 
+	0x51, 0x21, 0x70, 0x28, 0x72, 0x62, 0x78, 0xca, 
+	0x8c, 0xc2, 0x8c, 0xda, 0x8c, 0xf4, 0x96, 0xf7, 
+	0x4e, 0x86, 0x50, 0xda, 0x5b, 0xee, 0x5e, 0xd6, 
+	0x65, 0x99, 0x71, 0xce, 0x76, 0x42, 0x77, 0xad, 
+	0x80, 0x4a, 0x84, 0xfc, 0x90, 0x7c, 0x9b, 0x27, 
+	0x9f, 0x8d, 0x58, 0xd8, 0x5a, 0x41, 0x5c, 0x62, 
+	0x6a, 0x13, 0x6d, 0xda, 0x6f, 0x0f, 0x76, 0x3b, 
+	0x7d, 0x2f, 0x7e, 0x37, 0x85, 0x1e, 0x89, 0x38, 
+	0x93, 0xe4, 0x96, 0x4b, 0x52, 0x89, 0x65, 0xd2, 
+	0x67, 0xf3, 0x69, 0xb4, 0x6d, 0x41, 0x6e, 0x9c, 
+	0x70, 0x0f, 0x74, 0x09, 0x74, 0x60, 0x75, 0x59, 
+	0x76, 0x24, 0x78, 0x6b, 0x8b, 0x2c, 0x98, 0x5e, 
+	0x51, 0x6d, 0x62, 0x2e, 0x96, 0x78, 0x4f, 0x96, 
+	0x50, 0x2b, 0x5d, 0x19, 0x6d, 0xea, 0x7d, 0xb8, 
+	0x8f, 0x2a, 0x5f, 0x8b, 0x61, 0x44, 0x68, 0x17, 
+	0xf9, 0x61, 0x96, 0x86, 0x52, 0xd2, 0x80, 0x8b, 
+	0x51, 0xdc, 0x51, 0xcc, 0x69, 0x5e, 0x7a, 0x1c, 
+	0x7d, 0xbe, 0x83, 0xf1, 0x96, 0x75, 0x4f, 0xda, 
+	0x52, 0x29, 0x53, 0x98, 0x54, 0x0f, 0x55, 0x0e, 
+	0x5c, 0x65, 0x60, 0xa7, 0x67, 0x4e, 0x68, 0xa8, 
+	0x6d, 0x6c, 0x72, 0x81, 0x72, 0xf8, 0x74, 0x06, 
+	0x74, 0x83, 0xf9, 0x62, 0x75, 0xe2, 0x7c, 0x6c, 
+	0x7f, 0x79, 0x7f, 0xb8, 0x83, 0x89, 0x88, 0xcf, 
+	0x88, 0xe1, 0x91, 0xcc, 0x91, 0xd0, 0x96, 0xe2, 
+	0x9b, 0xc9, 0x54, 0x1d, 0x6f, 0x7e, 0x71, 0xd0, 
+	0x74, 0x98, 0x85, 0xfa, 0x8e, 0xaa, 0x96, 0xa3, 
+	0x9c, 0x57, 0x9e, 0x9f, 0x67, 0x97, 0x6d, 0xcb, 
+	0x74, 0x33, 0x81, 0xe8, 0x97, 0x16, 0x78, 0x2c, 
+	0x7a, 0xcb, 0x7b, 0x20, 0x7c, 0x92, 0x64, 0x69, 
+	0x74, 0x6a, 0x75, 0xf2, 0x78, 0xbc, 0x78, 0xe8, 
+	0x99, 0xac, 0x9b, 0x54, 0x9e, 0xbb, 0x5b, 0xde, 
+	0x5e, 0x55, 0x6f, 0x20, 0x81, 0x9c, 0x83, 0xab, 
+	0x90, 0x88, 0x4e, 0x07, 0x53, 0x4d, 0x5a, 0x29, 
+	0x5d, 0xd2, 0x5f, 0x4e, 0x61, 0x62, 0x63, 0x3d, 
+	0x66, 0x69, 0x66, 0xfc, 0x6e, 0xff, 0x6f, 0x2b, 
+	0x70, 0x63, 0x77, 0x9e, 0x84, 0x2c, 0x85, 0x13, 
+	0x88, 0x3b, 0x8f, 0x13, 0x99, 0x45, 0x9c, 0x3b, 
+	0x55, 0x1c, 0x62, 0xb9, 0x67, 0x2b, 0x6c, 0xab, 
+	0x83, 0x09, 0x89, 0x6a, 0x97, 0x7a, 0x4e, 0xa1, 
+	0x59, 0x84, 0x5f, 0xd8, 0x5f, 0xd9, 0x67, 0x1b, 
+	0x7d, 0xb2, 0x7f, 0x54, 0x82, 0x92, 0x83, 0x2b, 
+	0x83, 0xbd, 0x8f, 0x1e, 0x90, 0x99, 0x57, 0xcb, 
+	0x59, 0xb9, 0x5a, 0x92, 0x5b, 0xd0, 0x66, 0x27, 
+	0x67, 0x9a, 0x68, 0x85, 0x6b, 0xcf, 0x71, 0x64, 
+	0x7f, 0x75, 0x8c, 0xb7, 0x8c, 0xe3, 0x90, 0x81, 
+	0x9b, 0x45, 0x81, 0x08, 0x8c, 0x8a, 0x96, 0x4c, 
+	0x9a, 0x40, 0x9e, 0xa5, 0x5b, 0x5f, 0x6c, 0x13, 
+	0x73, 0x1b, 0x76, 0xf2, 0x76, 0xdf, 0x84, 0x0c, 
+	0x51, 0xaa, 0x89, 0x93, 0x51, 0x4d, 0x51, 0x95, 
+	0x52, 0xc9, 0x68, 0xc9, 0x6c, 0x94, 0x77, 0x04, 
+	0x77, 0x20, 0x7d, 0xbf, 0x7d, 0xec, 0x97, 0x62, 
+	0x9e, 0xb5, 0x6e, 0xc5, 0x85, 0x11, 0x51, 0xa5, 
+	0x54, 0x0d, 0x54, 0x7d, 0x66, 0x0e, 0x66, 0x9d, 
+	0x69, 0x27, 0x6e, 0x9f, 0x76, 0xbf, 0x77, 0x91, 
+	0x83, 0x17, 0x84, 0xc2, 0x87, 0x9f, 0x91, 0x69, 
+	0x92, 0x98, 0x9c, 0xf4, 0x88, 0x82, 0x4f, 0xae, 
+	0x51, 0x92, 0x52, 0xdf, 0x59, 0xc6, 0x5e, 0x3d, 
+	0x61, 0x55, 0x64, 0x78, 0x64, 0x79, 0x66, 0xae, 
+	0x67, 0xd0, 0x6a, 0x21, 0x6b, 0xcd, 0x6b, 0xdb, 
+	0x72, 0x5f, 0x72, 0x61, 0x74, 0x41, 0x77, 0x38, 
+	0x77, 0xdb, 0x80, 0x17, 0x82, 0xbc, 0x83, 0x05, 
+	0x8b, 0x00, 0x8b, 0x28, 0x8c, 0x8c, 0x67, 0x28, 
+	0x6c, 0x90, 0x72, 0x67, 0x76, 0xee, 0x77, 0x66, 
+	0x7a, 0x46, 0x9d, 0xa9, 0x6b, 0x7f, 0x6c, 0x92, 
+	0x59, 0x22, 0x67, 0x26, 0x84, 0x99, 0x53, 0x6f, 
+	0x58, 0x93, 0x59, 0x99, 0x5e, 0xdf, 0x63, 0xcf, 
+	0x66, 0x34, 0x67, 0x73, 0x6e, 0x3a, 0x73, 0x2b, 
+	0x7a, 0xd7, 0x82, 0xd7, 0x93, 0x28, 0x52, 0xd9, 
+	0x5d, 0xeb, 0x61, 0xae, 0x61, 0xcb, 0x62, 0x0a, 
+	0x62, 0xc7, 0x64, 0xab, 0x65, 0xe0, 0x69, 0x59, 
+	0x6b, 0x66, 0x6b, 0xcb, 0x71, 0x21, 0x73, 0xf7, 
+	0x75, 0x5d, 0x7e, 0x46, 0x82, 0x1e, 0x83, 0x02, 
+	0x85, 0x6a, 0x8a, 0xa3, 0x8c, 0xbf, 0x97, 0x27, 
+	0x9d, 0x61, 0x58, 0xa8, 0x9e, 0xd8, 0x50, 0x11, 
+	0x52, 0x0e, 0x54, 0x3b, 0x55, 0x4f, 0x65, 0x87, 
+	0x6c, 0x76, 0x7d, 0x0a, 0x7d, 0x0b, 0x80, 0x5e, 
+	0x86, 0x8a, 0x95, 0x80, 0x96, 0xef, 0x52, 0xff, 
+	0x6c, 0x95, 0x72, 0x69, 0x54, 0x73, 0x5a, 0x9a, 
+	0x5c, 0x3e, 0x5d, 0x4b, 0x5f, 0x4c, 0x5f, 0xae, 
+	0x67, 0x2a, 0x68, 0xb6, 0x69, 0x63, 0x6e, 0x3c, 
+	0x6e, 0x44, 0x77, 0x09, 0x7c, 0x73, 0x7f, 0x8e, 
+	0x85, 0x87, 0x8b, 0x0e, 0x8f, 0xf7, 0x97, 0x61, 
+	0x9e, 0xf4, 0x5c, 0xb7, 0x60, 0xb6, 0x61, 0x0d, 
+	0x61, 0xab, 0x65, 0x4f, 0x65, 0xfb, 0x65, 0xfc, 
+	0x6c, 0x11, 0x6c, 0xef, 0x73, 0x9f, 0x73, 0xc9, 
+	0x7d, 0xe1, 0x95, 0x94, 0x5b, 0xc6, 0x87, 0x1c, 
+	0x8b, 0x10, 0x52, 0x5d, 0x53, 0x5a, 0x62, 0xcd, 
+	0x64, 0x0f, 0x64, 0xb2, 0x67, 0x34, 0x6a, 0x38, 
+	0x6c, 0xca, 0x73, 0xc0, 0x74, 0x9e, 0x7b, 0x94, 
+	0x7c, 0x95, 0x7e, 0x1b, 0x81, 0x8a, 0x82, 0x36, 
+	0x85, 0x84, 0x8f, 0xeb, 0x96, 0xf9, 0x99, 0xc1, 
+	0x4f, 0x34, 0x53, 0x4a, 0x53, 0xcd, 0x53, 0xdb, 
+	0x62, 0xcc, 0x64, 0x2c, 0x65, 0x00, 0x65, 0x91, 
+	0x69, 0xc3, 0x6c, 0xee, 0x6f, 0x58, 0x73, 0xed, 
+	0x75, 0x54, 0x76, 0x22, 0x76, 0xe4, 0x76, 0xfc, 
+	0x78, 0xd0, 0x78, 0xfb, 0x79, 0x2c, 0x7d, 0x46, 
+	0x82, 0x2c, 0x87, 0xe0, 0x8f, 0xd4, 0x98, 0x12, 
+	0x98, 0xef, 0x52, 0xc3, 0x62, 0xd4, 0x64, 0xa5, 
+	0x6e, 0x24, 0x6f, 0x51, 0x76, 0x7c, 0x8d, 0xcb, 
+	0x91, 0xb1, 0x92, 0x62, 0x9a, 0xee, 0x9b, 0x43, 
+	0x50, 0x23, 0x50, 0x8d, 0x57, 0x4a, 0x59, 0xa8, 
+	0x5c, 0x28, 0x5e, 0x47, 0x5f, 0x77, 0x62, 0x3f, 
+	0x65, 0x3e, 0x65, 0xb9, 0x65, 0xc1, 0x66, 0x09, 
+	0x67, 0x8b, 0x69, 0x9c, 0x6e, 0xc2, 0x78, 0xc5, 
+	0x7d, 0x21, 0x80, 0xaa, 0x81, 0x80, 0x82, 0x2b, 
+	0x82, 0xb3, 0x84, 0xa1, 0x86, 0x8c, 0x8a, 0x2a, 
+	0x8b, 0x17, 0x90, 0xa6, 0x96, 0x32, 0x9f, 0x90, 
+	0x50, 0x0d, 0x4f, 0xf3, 0xf9, 0x63, 0x57, 0xf9, 
+	0x5f, 0x98, 0x62, 0xdc, 0x63, 0x92, 0x67, 0x6f, 
+	0x6e, 0x43, 0x71, 0x19, 0x76, 0xc3, 0x80, 0xcc, 
+	0x80, 0xda, 0x88, 0xf4, 0x88, 0xf5, 0x89, 0x19, 
+	0x8c, 0xe0, 0x8f, 0x29, 0x91, 0x4d, 0x96, 0x6a, 
+	0x4f, 0x2f, 0x4f, 0x70, 0x5e, 0x1b, 0x67, 0xcf, 
+	0x68, 0x22, 0x76, 0x7d, 0x76, 0x7e, 0x9b, 0x44, 
+	0x5e, 0x61, 0x6a, 0x0a, 0x71, 0x69, 0x71, 0xd4, 
+	0x75, 0x6a, 0xf9, 0x64, 0x7e, 0x41, 0x85, 0x43, 
+	0x85, 0xe9, 0x98, 0xdc, 0x4f, 0x10, 0x7b, 0x4f, 
+	0x7f, 0x70, 0x95, 0xa5, 0x51, 0xe1, 0x5e, 0x06, 
+	0x68, 0xb5, 0x6c, 0x3e, 0x6c, 0x4e, 0x6c, 0xdb, 
+	0x72, 0xaf, 0x7b, 0xc4, 0x83, 0x03, 0x6c, 0xd5, 
+	0x74, 0x3a, 0x50, 0xfb, 0x52, 0x88, 0x58, 0xc1, 
+	0x64, 0xd8, 0x6a, 0x97, 0x74, 0xa7, 0x76, 0x56, 
+	0x78, 0xa7, 0x86, 0x17, 0x95, 0xe2, 0x97, 0x39, 
+	0xf9, 0x65, 0x53, 0x5e, 0x5f, 0x01, 0x8b, 0x8a, 
+	0x8f, 0xa8, 0x8f, 0xaf, 0x90, 0x8a, 0x52, 0x25, 
+	0x77, 0xa5, 0x9c, 0x49, 0x9f, 0x08, 0x4e, 0x19, 
+	0x50, 0x02, 0x51, 0x75, 0x5c, 0x5b, 0x5e, 0x77, 
+	0x66, 0x1e, 0x66, 0x3a, 0x67, 0xc4, 0x68, 0xc5, 
+	0x70, 0xb3, 0x75, 0x01, 0x75, 0xc5, 0x79, 0xc9, 
+	0x7a, 0xdd, 0x8f, 0x27, 0x99, 0x20, 0x9a, 0x08, 
+	0x4f, 0xdd, 0x58, 0x21, 0x58, 0x31, 0x5b, 0xf6, 
+	0x66, 0x6e, 0x6b, 0x65, 0x6d, 0x11, 0x6e, 0x7a, 
+	0x6f, 0x7d, 0x73, 0xe4, 0x75, 0x2b, 0x83, 0xe9, 
+	0x88, 0xdc, 0x89, 0x13, 0x8b, 0x5c, 0x8f, 0x14, 
+	0x4f, 0x0f, 0x50, 0xd5, 0x53, 0x10, 0x53, 0x5c, 
+	0x5b, 0x93, 0x5f, 0xa9, 0x67, 0x0d, 0x79, 0x8f, 
+	0x81, 0x79, 0x83, 0x2f, 0x85, 0x14, 0x89, 0x07, 
+	0x89, 0x86, 0x8f, 0x39, 0x8f, 0x3b, 0x99, 0xa5, 
+	0x9c, 0x12, 0x67, 0x2c, 0x4e, 0x76, 0x4f, 0xf8, 
+	0x59, 0x49, 0x5c, 0x01, 0x5c, 0xef, 0x5c, 0xf0, 
+	0x63, 0x67, 0x68, 0xd2, 0x70, 0xfd, 0x71, 0xa2, 
+	0x74, 0x2b, 0x7e, 0x2b, 0x84, 0xec, 0x87, 0x02, 
+	0x90, 0x22, 0x92, 0xd2, 0x9c, 0xf3, 0x4e, 0x0d, 
+	0x4e, 0xd8, 0x4f, 0xef, 0x50, 0x85, 0x52, 0x56, 
+	0x52, 0x6f, 0x54, 0x26, 0x54, 0x90, 0x57, 0xe0, 
+	0x59, 0x2b, 0x5a, 0x66, 0x5b, 0x5a, 0x5b, 0x75, 
+	0x5b, 0xcc, 0x5e, 0x9c, 0xf9, 0x66, 0x62, 0x76, 
+	0x65, 0x77, 0x65, 0xa7, 0x6d, 0x6e, 0x6e, 0xa5, 
+	0x72, 0x36, 0x7b, 0x26, 0x7c, 0x3f, 0x7f, 0x36, 
+	0x81, 0x50, 0x81, 0x51, 0x81, 0x9a, 0x82, 0x40, 
+	0x82, 0x99, 0x83, 0xa9, 0x8a, 0x03, 0x8c, 0xa0, 
+	0x8c, 0xe6, 0x8c, 0xfb, 0x8d, 0x74, 0x8d, 0xba, 
+	0x90, 0xe8, 0x91, 0xdc, 0x96, 0x1c, 0x96, 0x44, 
+	0x99, 0xd9, 0x9c, 0xe7, 0x53, 0x17, 0x52, 0x06, 
+	0x54, 0x29, 0x56, 0x74, 0x58, 0xb3, 0x59, 0x54, 
+	0x59, 0x6e, 0x5f, 0xff, 0x61, 0xa4, 0x62, 0x6e, 
+	0x66, 0x10, 0x6c, 0x7e, 0x71, 0x1a, 0x76, 0xc6, 
+	0x7c, 0x89, 0x7c, 0xde, 0x7d, 0x1b, 0x82, 0xac, 
+	0x8c, 0xc1, 0x96, 0xf0, 0xf9, 0x67, 0x4f, 0x5b, 
+	0x5f, 0x17, 0x5f, 0x7f, 0x62, 0xc2, 0x5d, 0x29, 
+	0x67, 0x0b, 0x68, 0xda, 0x78, 0x7c, 0x7e, 0x43, 
+	0x9d, 0x6c, 0x4e, 0x15, 0x50, 0x99, 0x53, 0x15, 
+	0x53, 0x2a, 0x53, 0x51, 0x59, 0x83, 0x5a, 0x62, 
+	0x5e, 0x87, 0x60, 0xb2, 0x61, 0x8a, 0x62, 0x49, 
+	0x62, 0x79, 0x65, 0x90, 0x67, 0x87, 0x69, 0xa7, 
+	0x6b, 0xd4, 0x6b, 0xd6, 0x6b, 0xd7, 0x6b, 0xd8, 
+	0x6c, 0xb8, 0xf9, 0x68, 0x74, 0x35, 0x75, 0xfa, 
+	0x78, 0x12, 0x78, 0x91, 0x79, 0xd5, 0x79, 0xd8, 
+	0x7c, 0x83, 0x7d, 0xcb, 0x7f, 0xe1, 0x80, 0xa5, 
+	0x81, 0x3e, 0x81, 0xc2, 0x83, 0xf2, 0x87, 0x1a, 
+	0x88, 0xe8, 0x8a, 0xb9, 0x8b, 0x6c, 0x8c, 0xbb, 
+	0x91, 0x19, 0x97, 0x5e, 0x98, 0xdb, 0x9f, 0x3b, 
+	0x56, 0xac, 0x5b, 0x2a, 0x5f, 0x6c, 0x65, 0x8c, 
+	0x6a, 0xb3, 0x6b, 0xaf, 0x6d, 0x5c, 0x6f, 0xf1, 
+	0x70, 0x15, 0x72, 0x5d, 0x73, 0xad, 0x8c, 0xa7, 
+	0x8c, 0xd3, 0x98, 0x3b, 0x61, 0x91, 0x6c, 0x37, 
+	0x80, 0x58, 0x9a, 0x01, 0x4e, 0x4d, 0x4e, 0x8b, 
+	0x4e, 0x9b, 0x4e, 0xd5, 0x4f, 0x3a, 0x4f, 0x3c, 
+	0x4f, 0x7f, 0x4f, 0xdf, 0x50, 0xff, 0x53, 0xf2, 
+	0x53, 0xf8, 0x55, 0x06, 0x55, 0xe3, 0x56, 0xdb, 
+	0x58, 0xeb, 0x59, 0x62, 0x5a, 0x11, 0x5b, 0xeb, 
+	0x5b, 0xfa, 0x5c, 0x04, 0x5d, 0xf3, 0x5e, 0x2b, 
+	0x5f, 0x99, 0x60, 0x1d, 0x63, 0x68, 0x65, 0x9c, 
+	0x65, 0xaf, 0x67, 0xf6, 0x67, 0xfb, 0x68, 0xad, 
+	0x6b, 0x7b, 0x6c, 0x99, 0x6c, 0xd7, 0x6e, 0x23, 
+	0x70, 0x09, 0x73, 0x45, 0x78, 0x02, 0x79, 0x3e, 
+	0x79, 0x40, 0x79, 0x60, 0x79, 0xc1, 0x7b, 0xe9, 
+	0x7d, 0x17, 0x7d, 0x72, 0x80, 0x86, 0x82, 0x0d, 
+	0x83, 0x8e, 0x84, 0xd1, 0x86, 0xc7, 0x88, 0xdf, 
+	0x8a, 0x50, 0x8a, 0x5e, 0x8b, 0x1d, 0x8c, 0xdc, 
+	0x8d, 0x66, 0x8f, 0xad, 0x90, 0xaa, 0x98, 0xfc, 
+	0x99, 0xdf, 0x9e, 0x9d, 0x52, 0x4a, 0xf9, 0x69, 
+	0x67, 0x14, 0xf9, 0x6a, 0x50, 0x98, 0x52, 0x2a, 
+	0x5c, 0x71, 0x65, 0x63, 0x6c, 0x55, 0x73, 0xca, 
+	0x75, 0x23, 0x75, 0x9d, 0x7b, 0x97, 0x84, 0x9c, 
+	0x91, 0x78, 0x97, 0x30, 0x4e, 0x77, 0x64, 0x92, 
+	0x6b, 0xba, 0x71, 0x5e, 0x85, 0xa9, 0x4e, 0x09, 
+	0xf9, 0x6b, 0x67, 0x49, 0x68, 0xee, 0x6e, 0x17, 
+	0x82, 0x9f, 0x85, 0x18, 0x88, 0x6b, 0x63, 0xf7, 
+	0x6f, 0x81, 0x92, 0x12, 0x98, 0xaf, 0x4e, 0x0a, 
+	0x50, 0xb7, 0x50, 0xcf, 0x51, 0x1f, 0x55, 0x46, 
+	0x55, 0xaa, 0x56, 0x17, 0x5b, 0x40, 0x5c, 0x19, 
+	0x5c, 0xe0, 0x5e, 0x38, 0x5e, 0x8a, 0x5e, 0xa0, 
+	0x5e, 0xc2, 0x60, 0xf3, 0x68, 0x51, 0x6a, 0x61, 
+	0x6e, 0x58, 0x72, 0x3d, 0x72, 0x40, 0x72, 0xc0, 
+	0x76, 0xf8, 0x79, 0x65, 0x7b, 0xb1, 0x7f, 0xd4, 
+	0x88, 0xf3, 0x89, 0xf4, 0x8a, 0x73, 0x8c, 0x61, 
+	0x8c, 0xde, 0x97, 0x1c, 0x58, 0x5e, 0x74, 0xbd, 
+	0x8c, 0xfd, 0x55, 0xc7, 0xf9, 0x6c, 0x7a, 0x61, 
+	0x7d, 0x22, 0x82, 0x72, 0x72, 0x72, 0x75, 0x1f, 
+	0x75, 0x25, 0xf9, 0x6d, 0x7b, 0x19, 0x58, 0x85, 
+	0x58, 0xfb, 0x5d, 0xbc, 0x5e, 0x8f, 0x5e, 0xb6, 
+	0x5f, 0x90, 0x60, 0x55, 0x62, 0x92, 0x63, 0x7f, 
+	0x65, 0x4d, 0x66, 0x91, 0x66, 0xd9, 0x66, 0xf8, 
+	0x68, 0x16, 0x68, 0xf2, 0x72, 0x80, 0x74, 0x5e, 
+	0x7b, 0x6e, 0x7d, 0x6e, 0x7d, 0xd6, 0x7f, 0x72, 
+	0x80, 0xe5, 0x82, 0x12, 0x85, 0xaf, 0x89, 0x7f, 
+	0x8a, 0x93, 0x90, 0x1d, 0x92, 0xe4, 0x9e, 0xcd, 
+	0x9f, 0x20, 0x59, 0x15, 0x59, 0x6d, 0x5e, 0x2d, 
+	0x60, 0xdc, 0x66, 0x14, 0x66, 0x73, 0x67, 0x90, 
+	0x6c, 0x50, 0x6d, 0xc5, 0x6f, 0x5f, 0x77, 0xf3, 
+	0x78, 0xa9, 0x84, 0xc6, 0x91, 0xcb, 0x93, 0x2b, 
+	0x4e, 0xd9, 0x50, 0xca, 0x51, 0x48, 0x55, 0x84, 
+	0x5b, 0x0b, 0x5b, 0xa3, 0x62, 0x47, 0x65, 0x7e, 
+	0x65, 0xcb, 0x6e, 0x32, 0x71, 0x7d, 0x74, 0x01, 
+	0x74, 0x44, 0x74, 0x87, 0x74, 0xbf, 0x76, 0x6c, 
+	0x79, 0xaa, 0x7d, 0xda, 0x7e, 0x55, 0x7f, 0xa8, 
+	0x81, 0x7a, 0x81, 0xb3, 0x82, 0x39, 0x86, 0x1a, 
+	0x87, 0xec, 0x8a, 0x75, 0x8d, 0xe3, 0x90, 0x78, 
+	0x92, 0x91, 0x94, 0x25, 0x99, 0x4d, 0x9b, 0xae, 
+	0x53, 0x68, 0x5c, 0x51, 0x69, 0x54, 0x6c, 0xc4, 
+	0x6d, 0x29, 0x6e, 0x2b, 0x82, 0x0c, 0x85, 0x9b, 
+	0x89, 0x3b, 0x8a, 0x2d, 0x8a, 0xaa, 0x96, 0xea, 
+	0x9f, 0x67, 0x52, 0x61, 0x66, 0xb9, 0x6b, 0xb2, 
+	0x7e, 0x96, 0x87, 0xfe, 0x8d, 0x0d, 0x95, 0x83, 
+	0x96, 0x5d, 0x65, 0x1d, 0x6d, 0x89, 0x71, 0xee, 
+	0xf9, 0x6e, 0x57, 0xce, 0x59, 0xd3, 0x5b, 0xac, 
+	0x60, 0x27, 0x60, 0xfa, 0x62, 0x10, 0x66, 0x1f, 
+	0x66, 0x5f, 0x73, 0x29, 0x73, 0xf9, 0x76, 0xdb, 
+	0x77, 0x01, 0x7b, 0x6c, 0x80, 0x56, 0x80, 0x72, 
+	0x81, 0x65, 0x8a, 0xa0, 0x91, 0x92, 0x4e, 0x16, 
+	0x52, 0xe2, 0x6b, 0x72, 0x6d, 0x17, 0x7a, 0x05, 
+	0x7b, 0x39, 0x7d, 0x30, 0xf9, 0x6f, 0x8c, 0xb0, 
+	0x53, 0xec, 0x56, 0x2f, 0x58, 0x51, 0x5b, 0xb5, 
+	0x5c, 0x0f, 0x5c, 0x11, 0x5d, 0xe2, 0x62, 0x40, 
+	0x63, 0x83, 0x64, 0x14, 0x66, 0x2d, 0x68, 0xb3, 
+	0x6c, 0xbc, 0x6d, 0x88, 0x6e, 0xaf, 0x70, 0x1f, 
+	0x70, 0xa4, 0x71, 0xd2, 0x75, 0x26, 0x75, 0x8f, 
+	0x75, 0x8e, 0x76, 0x19, 0x7b, 0x11, 0x7b, 0xe0, 
+	0x7c, 0x2b, 0x7d, 0x20, 0x7d, 0x39, 0x85, 0x2c, 
+	0x85, 0x6d, 0x86, 0x07, 0x8a, 0x34, 0x90, 0x0d, 
+	0x90, 0x61, 0x90, 0xb5, 0x92, 0xb7, 0x97, 0xf6, 
+	0x9a, 0x37, 0x4f, 0xd7, 0x5c, 0x6c, 0x67, 0x5f, 
+	0x6d, 0x91, 0x7c, 0x9f, 0x7e, 0x8c, 0x8b, 0x16, 
+	0x8d, 0x16, 0x90, 0x1f, 0x5b, 0x6b, 0x5d, 0xfd, 
+	0x64, 0x0d, 0x84, 0xc0, 0x90, 0x5c, 0x98, 0xe1, 
+	0x73, 0x87, 0x5b, 0x8b, 0x60, 0x9a, 0x67, 0x7e, 
+	0x6d, 0xde, 0x8a, 0x1f, 0x8a, 0xa6, 0x90, 0x01, 
+	0x98, 0x0c, 0x52, 0x37, 0xf9, 0x70, 0x70, 0x51, 
+	0x78, 0x8e, 0x93, 0x96, 0x88, 0x70, 0x91, 0xd7, 
+	0x4f, 0xee, 0x53, 0xd7, 0x55, 0xfd, 0x56, 0xda, 
+	0x57, 0x82, 0x58, 0xfd, 0x5a, 0xc2, 0x5b, 0x88, 
+	0x5c, 0xab, 0x5c, 0xc0, 0x5e, 0x25, 0x61, 0x01, 
+	0x62, 0x0d, 0x62, 0x4b, 0x63, 0x88, 0x64, 0x1c, 
+	0x65, 0x36, 0x65, 0x78, 0x6a, 0x39, 0x6b, 0x8a, 
+	0x6c, 0x34, 0x6d, 0x19, 0x6f, 0x31, 0x71, 0xe7, 
+	0x72, 0xe9, 0x73, 0x78, 0x74, 0x07, 0x74, 0xb2, 
+	0x76, 0x26, 0x77, 0x61, 0x79, 0xc0, 0x7a, 0x57, 
+	0x7a, 0xea, 0x7c, 0xb9, 0x7d, 0x8f, 0x7d, 0xac, 
+	0x7e, 0x61, 0x7f, 0x9e, 0x81, 0x29, 0x83, 0x31, 
+	0x84, 0x90, 0x84, 0xda, 0x85, 0xea, 0x88, 0x96, 
+	0x8a, 0xb0, 0x8b, 0x90, 0x8f, 0x38, 0x90, 0x42, 
+	0x90, 0x83, 0x91, 0x6c, 0x92, 0x96, 0x92, 0xb9, 
+	0x96, 0x8b, 0x96, 0xa7, 0x96, 0xa8, 0x96, 0xd6, 
+	0x97, 0x00, 0x98, 0x08, 0x99, 0x96, 0x9a, 0xd3, 
+	0x9b, 0x1a, 0x53, 0xd4, 0x58, 0x7e, 0x59, 0x19, 
+	0x5b, 0x70, 0x5b, 0xbf, 0x6d, 0xd1, 0x6f, 0x5a, 
+	0x71, 0x9f, 0x74, 0x21, 0x74, 0xb9, 0x80, 0x85, 
+	0x83, 0xfd, 0x5d, 0xe1, 0x5f, 0x87, 0x5f, 0xaa, 
+	0x60, 0x42, 0x65, 0xec, 0x68, 0x12, 0x69, 0x6f, 
+	0x6a, 0x53, 0x6b, 0x89, 0x6d, 0x35, 0x6d, 0xf3, 
+	0x73, 0xe3, 0x76, 0xfe, 0x77, 0xac, 0x7b, 0x4d, 
+	0x7d, 0x14, 0x81, 0x23, 0x82, 0x1c, 0x83, 0x40, 
+	0x84, 0xf4, 0x85, 0x63, 0x8a, 0x62, 0x8a, 0xc4, 
+	0x91, 0x87, 0x93, 0x1e, 0x98, 0x06, 0x99, 0xb4, 
+	0x62, 0x0c, 0x88, 0x53, 0x8f, 0xf0, 0x92, 0x65, 
+	0x5d, 0x07, 0x5d, 0x27, 0x5d, 0x69, 0x74, 0x5f, 
+	0x81, 0x9d, 0x87, 0x68, 0x6f, 0xd5, 0x62, 0xfe, 
+	0x7f, 0xd2, 0x89, 0x36, 0x89, 0x72, 0x4e, 0x1e, 
+	0x4e, 0x58, 0x50, 0xe7, 0x52, 0xdd, 0x53, 0x47, 
+	0x62, 0x7f, 0x66, 0x07, 0x7e, 0x69, 0x88, 0x05, 
+	0x96, 0x5e, 0x4f, 0x8d, 0x53, 0x19, 0x56, 0x36, 
+	0x59, 0xcb, 0x5a, 0xa4, 0x5c, 0x38, 0x5c, 0x4e, 
+	0x5c, 0x4d, 0x5e, 0x02, 0x5f, 0x11, 0x60, 0x43, 
+	0x65, 0xbd, 0x66, 0x2f, 0x66, 0x42, 0x67, 0xbe, 
+	0x67, 0xf4, 0x73, 0x1c, 0x77, 0xe2, 0x79, 0x3a, 
+	0x7f, 0xc5, 0x84, 0x94, 0x84, 0xcd, 0x89, 0x96, 
+	0x8a, 0x66, 0x8a, 0x69, 0x8a, 0xe1, 0x8c, 0x55, 
+	0x8c, 0x7a, 0x57, 0xf4, 0x5b, 0xd4, 0x5f, 0x0f, 
+	0x60, 0x6f, 0x62, 0xed, 0x69, 0x0d, 0x6b, 0x96, 
+	0x6e, 0x5c, 0x71, 0x84, 0x7b, 0xd2, 0x87, 0x55, 
+	0x8b, 0x58, 0x8e, 0xfe, 0x98, 0xdf, 0x98, 0xfe, 
+	0x4f, 0x38, 0x4f, 0x81, 0x4f, 0xe1, 0x54, 0x7b, 
+	0x5a, 0x20, 0x5b, 0xb8, 0x61, 0x3c, 0x65, 0xb0, 
+	0x66, 0x68, 0x71, 0xfc, 0x75, 0x33, 0x79, 0x5e, 
+	0x7d, 0x33, 0x81, 0x4e, 0x81, 0xe3, 0x83, 0x98, 
+	0x85, 0xaa, 0x85, 0xce, 0x87, 0x03, 0x8a, 0x0a, 
+	0x8e, 0xab, 0x8f, 0x9b, 0xf9, 0x71, 0x8f, 0xc5, 
+	0x59, 0x31, 0x5b, 0xa4, 0x5b, 0xe6, 0x60, 0x89, 
+	0x5b, 0xe9, 0x5c, 0x0b, 0x5f, 0xc3, 0x6c, 0x81, 
+	0xf9, 0x72, 0x6d, 0xf1, 0x70, 0x0b, 0x75, 0x1a, 
+	0x82, 0xaf, 0x8a, 0xf6, 0x4e, 0xc0, 0x53, 0x41, 
+	0xf9, 0x73, 0x96, 0xd9, 0x6c, 0x0f, 0x4e, 0x9e, 
+	0x4f, 0xc4, 0x51, 0x52, 0x55, 0x5e, 0x5a, 0x25, 
+	0x5c, 0xe8, 0x62, 0x11, 0x72, 0x59, 0x82, 0xbd, 
+	0x83, 0xaa, 0x86, 0xfe, 0x88, 0x59, 0x8a, 0x1d, 
+	0x96, 0x3f, 0x96, 0xc5, 0x99, 0x13, 0x9d, 0x09, 
+	0x9d, 0x5d, 0x58, 0x0a, 0x5c, 0xb3, 0x5d, 0xbd, 
+	0x5e, 0x44, 0x60, 0xe1, 0x61, 0x15, 0x63, 0xe1, 
+	0x6a, 0x02, 0x6e, 0x25, 0x91, 0x02, 0x93, 0x54, 
+	0x98, 0x4e, 0x9c, 0x10, 0x9f, 0x77, 0x5b, 0x89, 
+	0x5c, 0xb8, 0x63, 0x09, 0x66, 0x4f, 0x68, 0x48, 
+	0x77, 0x3c, 0x96, 0xc1, 0x97, 0x8d, 0x98, 0x54, 
+	0x9b, 0x9f, 0x65, 0xa1, 0x8b, 0x01, 0x8e, 0xcb, 
+	0x95, 0xbc, 0x55, 0x35, 0x5c, 0xa9, 0x5d, 0xd6, 
+	0x5e, 0xb5, 0x66, 0x97, 0x76, 0x4c, 0x83, 0xf4, 
+	0x95, 0xc7, 0x58, 0xd3, 0x62, 0xbc, 0x72, 0xce, 
+	0x9d, 0x28, 0x4e, 0xf0, 0x59, 0x2e, 0x60, 0x0f, 
+	0x66, 0x3b, 0x6b, 0x83, 0x79, 0xe7, 0x9d, 0x26, 
+	0x53, 0x93, 0x54, 0xc0, 0x57, 0xc3, 0x5d, 0x16, 
+	0x61, 0x1b, 0x66, 0xd6, 0x6d, 0xaf, 0x78, 0x8d, 
+	0x82, 0x7e, 0x96, 0x98, 0x97, 0x44, 0x53, 0x84, 
+	0x62, 0x7c, 0x63, 0x96, 0x6d, 0xb2, 0x7e, 0x0a, 
+	0x81, 0x4b, 0x98, 0x4d, 0x6a, 0xfb, 0x7f, 0x4c, 
+	0x9d, 0xaf, 0x9e, 0x1a, 0x4e, 0x5f, 0x50, 0x3b, 
+	0x51, 0xb6, 0x59, 0x1c, 0x60, 0xf9, 0x63, 0xf6, 
+	0x69, 0x30, 0x72, 0x3a, 0x80, 0x36, 0xf9, 0x74, 
+	0x91, 0xce, 0x5f, 0x31, 0xf9, 0x75, 0xf9, 0x76, 
+	0x7d, 0x04, 0x82, 0xe5, 0x84, 0x6f, 0x84, 0xbb, 
+	0x85, 0xe5, 0x8e, 0x8d, 0xf9, 0x77, 0x4f, 0x6f, 
+	0xf9, 0x78, 0xf9, 0x79, 0x58, 0xe4, 0x5b, 0x43, 
+	0x60, 0x59, 0x63, 0xda, 0x65, 0x18, 0x65, 0x6d, 
+	0x66, 0x98, 0xf9, 0x7a, 0x69, 0x4a, 0x6a, 0x23, 
+	0x6d, 0x0b, 0x70, 0x01, 0x71, 0x6c, 0x75, 0xd2, 
+	0x76, 0x0d, 0x79, 0xb3, 0x7a, 0x70, 0xf9, 0x7b, 
+	0x7f, 0x8a, 0xf9, 0x7c, 0x89, 0x44, 0xf9, 0x7d, 
+	0x8b, 0x93, 0x91, 0xc0, 0x96, 0x7d, 0xf9, 0x7e, 
+	0x99, 0x0a, 0x57, 0x04, 0x5f, 0xa1, 0x65, 0xbc, 
+	0x6f, 0x01, 0x76, 0x00, 0x79, 0xa6, 0x8a, 0x9e, 
+	0x99, 0xad, 0x9b, 0x5a, 0x9f, 0x6c, 0x51, 0x04, 
+	0x61, 0xb6, 0x62, 0x91, 0x6a, 0x8d, 0x81, 0xc6, 
+	0x50, 0x43, 0x58, 0x30, 0x5f, 0x66, 0x71, 0x09, 
+	0x8a, 0x00, 0x8a, 0xfa, 0x5b, 0x7c, 0x86, 0x16, 
+	0x4f, 0xfa, 0x51, 0x3c, 0x56, 0xb4, 0x59, 0x44, 
+	0x63, 0xa9, 0x6d, 0xf9, 0x5d, 0xaa, 0x69, 0x6d, 
+	0x51, 0x86, 0x4e, 0x88, 0x4f, 0x59, 0xf9, 0x7f, 
+	0xf9, 0x80, 0xf9, 0x81, 0x59, 0x82, 0xf9, 0x82, 
+	0xf9, 0x83, 0x6b, 0x5f, 0x6c, 0x5d, 0xf9, 0x84, 
+	0x74, 0xb5, 0x79, 0x16, 0xf9, 0x85, 0x82, 0x07, 
+	0x82, 0x45, 0x83, 0x39, 0x8f, 0x3f, 0x8f, 0x5d, 
+	0xf9, 0x86, 0x99, 0x18, 0xf9, 0x87, 0xf9, 0x88, 
+	0xf9, 0x89, 0x4e, 0xa6, 0xf9, 0x8a, 0x57, 0xdf, 
+	0x5f, 0x79, 0x66, 0x13, 0xf9, 0x8b, 0xf9, 0x8c, 
+	0x75, 0xab, 0x7e, 0x79, 0x8b, 0x6f, 0xf9, 0x8d, 
+	0x90, 0x06, 0x9a, 0x5b, 0x56, 0xa5, 0x58, 0x27, 
+	0x59, 0xf8, 0x5a, 0x1f, 0x5b, 0xb4, 0xf9, 0x8e, 
+	0x5e, 0xf6, 0xf9, 0x8f, 0xf9, 0x90, 0x63, 0x50, 
+	0x63, 0x3b, 0xf9, 0x91, 0x69, 0x3d, 0x6c, 0x87, 
+	0x6c, 0xbf, 0x6d, 0x8e, 0x6d, 0x93, 0x6d, 0xf5, 
+	0x6f, 0x14, 0xf9, 0x92, 0x70, 0xdf, 0x71, 0x36, 
+	0x71, 0x59, 0xf9, 0x93, 0x71, 0xc3, 0x71, 0xd5, 
+	0xf9, 0x94, 0x78, 0x4f, 0x78, 0x6f, 0xf9, 0x95, 
+	0x7b, 0x75, 0x7d, 0xe3, 0xf9, 0x96, 0x7e, 0x2f, 
+	0xf9, 0x97, 0x88, 0x4d, 0x8e, 0xdf, 0xf9, 0x98, 
+	0xf9, 0x99, 0xf9, 0x9a, 0x92, 0x5b, 0xf9, 0x9b, 
+	0x9c, 0xf6, 0xf9, 0x9c, 0xf9, 0x9d, 0xf9, 0x9e, 
+	0x60, 0x85, 0x6d, 0x85, 0xf9, 0x9f, 0x71, 0xb1, 
+	0xf9, 0xa0, 0xf9, 0xa1, 0x95, 0xb1, 0x53, 0xad, 
+	0xf9, 0xa2, 0xf9, 0xa3, 0xf9, 0xa4, 0x67, 0xd3, 
+	0xf9, 0xa5, 0x70, 0x8e, 0x71, 0x30, 0x74, 0x30, 
+	0x82, 0x76, 0x82, 0xd2, 0xf9, 0xa6, 0x95, 0xbb, 
+	0x9a, 0xe5, 0x9e, 0x7d, 0x66, 0xc4, 0xf9, 0xa7, 
+	0x71, 0xc1, 0x84, 0x49, 0xf9, 0xa8, 0xf9, 0xa9, 
+	0x58, 0x4b, 0xf9, 0xaa, 0xf9, 0xab, 0x5d, 0xb8, 
+	0x5f, 0x71, 0xf9, 0xac, 0x66, 0x20, 0x66, 0x8e, 
+	0x69, 0x79, 0x69, 0xae, 0x6c, 0x38, 0x6c, 0xf3, 
+	0x6e, 0x36, 0x6f, 0x41, 0x6f, 0xda, 0x70, 0x1b, 
+	0x70, 0x2f, 0x71, 0x50, 0x71, 0xdf, 0x73, 0x70, 
+	0xf9, 0xad, 0x74, 0x5b, 0xf9, 0xae, 0x74, 0xd4, 
+	0x76, 0xc8, 0x7a, 0x4e, 0x7e, 0x93, 0xf9, 0xaf, 
+	0xf9, 0xb0, 0x82, 0xf1, 0x8a, 0x60, 0x8f, 0xce, 
+	0xf9, 0xb1, 0x93, 0x48, 0xf9, 0xb2, 0x97, 0x19, 
+	0xf9, 0xb3, 0xf9, 0xb4, 0x4e, 0x42, 0x50, 0x2a, 
+	0xf9, 0xb5, 0x52, 0x08, 0x53, 0xe1, 0x66, 0xf3, 
+	0x6c, 0x6d, 0x6f, 0xca, 0x73, 0x0a, 0x77, 0x7f, 
+	0x7a, 0x62, 0x82, 0xae, 0x85, 0xdd, 0x86, 0x02, 
+	0xf9, 0xb6, 0x88, 0xd4, 0x8a, 0x63, 0x8b, 0x7d, 
+	0x8c, 0x6b, 0xf9, 0xb7, 0x92, 0xb3, 0xf9, 0xb8, 
+	0x97, 0x13, 0x98, 0x10, 0x4e, 0x94, 0x4f, 0x0d, 
+	0x4f, 0xc9, 0x50, 0xb2, 0x53, 0x48, 0x54, 0x3e, 
+	0x54, 0x33, 0x55, 0xda, 0x58, 0x62, 0x58, 0xba, 
+	0x59, 0x67, 0x5a, 0x1b, 0x5b, 0xe4, 0x60, 0x9f, 
+	0xf9, 0xb9, 0x61, 0xca, 0x65, 0x56, 0x65, 0xff, 
+	0x66, 0x64, 0x68, 0xa7, 0x6c, 0x5a, 0x6f, 0xb3, 
+	0x70, 0xcf, 0x71, 0xac, 0x73, 0x52, 0x7b, 0x7d, 
+	0x87, 0x08, 0x8a, 0xa4, 0x9c, 0x32, 0x9f, 0x07, 
+	0x5c, 0x4b, 0x6c, 0x83, 0x73, 0x44, 0x73, 0x89, 
+	0x92, 0x3a, 0x6e, 0xab, 0x74, 0x65, 0x76, 0x1f, 
+	0x7a, 0x69, 0x7e, 0x15, 0x86, 0x0a, 0x51, 0x40, 
+	0x58, 0xc5, 0x64, 0xc1, 0x74, 0xee, 0x75, 0x15, 
+	0x76, 0x70, 0x7f, 0xc1, 0x90, 0x95, 0x96, 0xcd, 
+	0x99, 0x54, 0x6e, 0x26, 0x74, 0xe6, 0x7a, 0xa9, 
+	0x7a, 0xaa, 0x81, 0xe5, 0x86, 0xd9, 0x87, 0x78, 
+	0x8a, 0x1b, 0x5a, 0x49, 0x5b, 0x8c, 0x5b, 0x9b, 
+	0x68, 0xa1, 0x69, 0x00, 0x6d, 0x63, 0x73, 0xa9, 
+	0x74, 0x13, 0x74, 0x2c, 0x78, 0x97, 0x7d, 0xe9, 
+	0x7f, 0xeb, 0x81, 0x18, 0x81, 0x55, 0x83, 0x9e, 
+	0x8c, 0x4c, 0x96, 0x2e, 0x98, 0x11, 0x66, 0xf0, 
+	0x5f, 0x80, 0x65, 0xfa, 0x67, 0x89, 0x6c, 0x6a, 
+	0x73, 0x8b, 0x50, 0x2d, 0x5a, 0x03, 0x6b, 0x6a, 
+	0x77, 0xee, 0x59, 0x16, 0x5d, 0x6c, 0x5d, 0xcd, 
+	0x73, 0x25, 0x75, 0x4f, 0xf9, 0xba, 0xf9, 0xbb, 
+	0x50, 0xe5, 0x51, 0xf9, 0x58, 0x2f, 0x59, 0x2d, 
+	0x59, 0x96, 0x59, 0xda, 0x5b, 0xe5, 0xf9, 0xbc, 
+	0xf9, 0xbd, 0x5d, 0xa2, 0x62, 0xd7, 0x64, 0x16, 
+	0x64, 0x93, 0x64, 0xfe, 0xf9, 0xbe, 0x66, 0xdc, 
+	0xf9, 0xbf, 0x6a, 0x48, 0xf9, 0xc0, 0x71, 0xff, 
+	0x74, 0x64, 0xf9, 0xc1, 0x7a, 0x88, 0x7a, 0xaf, 
+	0x7e, 0x47, 0x7e, 0x5e, 0x80, 0x00, 0x81, 0x70, 
+	0xf9, 0xc2, 0x87, 0xef, 0x89, 0x81, 0x8b, 0x20, 
+	0x90, 0x59, 0xf9, 0xc3, 0x90, 0x80, 0x99, 0x52, 
+	0x61, 0x7e, 0x6b, 0x32, 0x6d, 0x74, 0x7e, 0x1f, 
+	0x89, 0x25, 0x8f, 0xb1, 0x4f, 0xd1, 0x50, 0xad, 
+	0x51, 0x97, 0x52, 0xc7, 0x57, 0xc7, 0x58, 0x89, 
+	0x5b, 0xb9, 0x5e, 0xb8, 0x61, 0x42, 0x69, 0x95, 
+	0x6d, 0x8c, 0x6e, 0x67, 0x6e, 0xb6, 0x71, 0x94, 
+	0x74, 0x62, 0x75, 0x28, 0x75, 0x2c, 0x80, 0x73, 
+	0x83, 0x38, 0x84, 0xc9, 0x8e, 0x0a, 0x93, 0x94, 
+	0x93, 0xde, 0xf9, 0xc4, 0x4e, 0x8e, 0x4f, 0x51, 
+	0x50, 0x76, 0x51, 0x2a, 0x53, 0xc8, 0x53, 0xcb, 
+	0x53, 0xf3, 0x5b, 0x87, 0x5b, 0xd3, 0x5c, 0x24, 
+	0x61, 0x1a, 0x61, 0x82, 0x65, 0xf4, 0x72, 0x5b, 
+	0x73, 0x97, 0x74, 0x40, 0x76, 0xc2, 0x79, 0x50, 
+	0x79, 0x91, 0x79, 0xb9, 0x7d, 0x06, 0x7f, 0xbd, 
+	0x82, 0x8b, 0x85, 0xd5, 0x86, 0x5e, 0x8f, 0xc2, 
+	0x90, 0x47, 0x90, 0xf5, 0x91, 0xea, 0x96, 0x85, 
+	0x96, 0xe8, 0x96, 0xe9, 0x52, 0xd6, 0x5f, 0x67, 
+	0x65, 0xed, 0x66, 0x31, 0x68, 0x2f, 0x71, 0x5c, 
+	0x7a, 0x36, 0x90, 0xc1, 0x98, 0x0a, 0x4e, 0x91, 
+	0xf9, 0xc5, 0x6a, 0x52, 0x6b, 0x9e, 0x6f, 0x90, 
+	0x71, 0x89, 0x80, 0x18, 0x82, 0xb8, 0x85, 0x53, 
+	0x90, 0x4b, 0x96, 0x95, 0x96, 0xf2, 0x97, 0xfb, 
+	0x85, 0x1a, 0x9b, 0x31, 0x4e, 0x90, 0x71, 0x8a, 
+	0x96, 0xc4, 0x51, 0x43, 0x53, 0x9f, 0x54, 0xe1, 
+	0x57, 0x13, 0x57, 0x12, 0x57, 0xa3, 0x5a, 0x9b, 
+	0x5a, 0xc4, 0x5b, 0xc3, 0x60, 0x28, 0x61, 0x3f, 
+	0x63, 0xf4, 0x6c, 0x85, 0x6d, 0x39, 0x6e, 0x72, 
+	0x6e, 0x90, 0x72, 0x30, 0x73, 0x3f, 0x74, 0x57, 
+	0x82, 0xd1, 0x88, 0x81, 0x8f, 0x45, 0x90, 0x60, 
+	0xf9, 0xc6, 0x96, 0x62, 0x98, 0x58, 0x9d, 0x1b, 
+	0x67, 0x08, 0x8d, 0x8a, 0x92, 0x5e, 0x4f, 0x4d, 
+	0x50, 0x49, 0x50, 0xde, 0x53, 0x71, 0x57, 0x0d, 
+	0x59, 0xd4, 0x5a, 0x01, 0x5c, 0x09, 0x61, 0x70, 
+	0x66, 0x90, 0x6e, 0x2d, 0x72, 0x32, 0x74, 0x4b, 
+	0x7d, 0xef, 0x80, 0xc3, 0x84, 0x0e, 0x84, 0x66, 
+	0x85, 0x3f, 0x87, 0x5f, 0x88, 0x5b, 0x89, 0x18, 
+	0x8b, 0x02, 0x90, 0x55, 0x97, 0xcb, 0x9b, 0x4f, 
+	0x4e, 0x73, 0x4f, 0x91, 0x51, 0x12, 0x51, 0x6a, 
+	0xf9, 0xc7, 0x55, 0x2f, 0x55, 0xa9, 0x5b, 0x7a, 
+	0x5b, 0xa5, 0x5e, 0x7c, 0x5e, 0x7d, 0x5e, 0xbe, 
+	0x60, 0xa0, 0x60, 0xdf, 0x61, 0x08, 0x61, 0x09, 
+	0x63, 0xc4, 0x65, 0x38, 0x67, 0x09, 0xf9, 0xc8, 
+	0x67, 0xd4, 0x67, 0xda, 0xf9, 0xc9, 0x69, 0x61, 
+	0x69, 0x62, 0x6c, 0xb9, 0x6d, 0x27, 0xf9, 0xca, 
+	0x6e, 0x38, 0xf9, 0xcb, 0x6f, 0xe1, 0x73, 0x36, 
+	0x73, 0x37, 0xf9, 0xcc, 0x74, 0x5c, 0x75, 0x31, 
+	0xf9, 0xcd, 0x76, 0x52, 0xf9, 0xce, 0xf9, 0xcf, 
+	0x7d, 0xad, 0x81, 0xfe, 0x84, 0x38, 0x88, 0xd5, 
+	0x8a, 0x98, 0x8a, 0xdb, 0x8a, 0xed, 0x8e, 0x30, 
+	0x8e, 0x42, 0x90, 0x4a, 0x90, 0x3e, 0x90, 0x7a, 
+	0x91, 0x49, 0x91, 0xc9, 0x93, 0x6e, 0xf9, 0xd0, 
+	0xf9, 0xd1, 0x58, 0x09, 0xf9, 0xd2, 0x6b, 0xd3, 
+	0x80, 0x89, 0x80, 0xb2, 0xf9, 0xd3, 0xf9, 0xd4, 
+	0x51, 0x41, 0x59, 0x6b, 0x5c, 0x39, 0xf9, 0xd5, 
+	0xf9, 0xd6, 0x6f, 0x64, 0x73, 0xa7, 0x80, 0xe4, 
+	0x8d, 0x07, 0xf9, 0xd7, 0x92, 0x17, 0x95, 0x8f, 
+	0xf9, 0xd8, 0xf9, 0xd9, 0xf9, 0xda, 0xf9, 0xdb, 
+	0x80, 0x7f, 0x62, 0x0e, 0x70, 0x1c, 0x7d, 0x68, 
+	0x87, 0x8d, 0xf9, 0xdc, 0x57, 0xa0, 0x60, 0x69, 
+	0x61, 0x47, 0x6b, 0xb7, 0x8a, 0xbe, 0x92, 0x80, 
+	0x96, 0xb1, 0x4e, 0x59, 0x54, 0x1f, 0x6d, 0xeb, 
+	0x85, 0x2d, 0x96, 0x70, 0x97, 0xf3, 0x98, 0xee, 
+	0x63, 0xd6, 0x6c, 0xe3, 0x90, 0x91, 0x51, 0xdd, 
+	0x61, 0xc9, 0x81, 0xba, 0x9d, 0xf9, 0x4f, 0x9d, 
+	0x50, 0x1a, 0x51, 0x00, 0x5b, 0x9c, 0x61, 0x0f, 
+	0x61, 0xff, 0x64, 0xec, 0x69, 0x05, 0x6b, 0xc5, 
+	0x75, 0x91, 0x77, 0xe3, 0x7f, 0xa9, 0x82, 0x64, 
+	0x85, 0x8f, 0x87, 0xfb, 0x88, 0x63, 0x8a, 0xbc, 
+	0x8b, 0x70, 0x91, 0xab, 0x4e, 0x8c, 0x4e, 0xe5, 
+	0x4f, 0x0a, 0xf9, 0xdd, 0xf9, 0xde, 0x59, 0x37, 
+	0x59, 0xe8, 0xf9, 0xdf, 0x5d, 0xf2, 0x5f, 0x1b, 
+	0x5f, 0x5b, 0x60, 0x21, 0xf9, 0xe0, 0xf9, 0xe1, 
+	0xf9, 0xe2, 0xf9, 0xe3, 0x72, 0x3e, 0x73, 0xe5, 
+	0xf9, 0xe4, 0x75, 0x70, 0x75, 0xcd, 0xf9, 0xe5, 
+	0x79, 0xfb, 0xf9, 0xe6, 0x80, 0x0c, 0x80, 0x33, 
+	0x80, 0x84, 0x82, 0xe1, 0x83, 0x51, 0xf9, 0xe7, 
+	0xf9, 0xe8, 0x8c, 0xbd, 0x8c, 0xb3, 0x90, 0x87, 
+	0xf9, 0xe9, 0xf9, 0xea, 0x98, 0xf4, 0x99, 0x0c, 
+	0xf9, 0xeb, 0xf9, 0xec, 0x70, 0x37, 0x76, 0xca, 
+	0x7f, 0xca, 0x7f, 0xcc, 0x7f, 0xfc, 0x8b, 0x1a, 
+	0x4e, 0xba, 0x4e, 0xc1, 0x52, 0x03, 0x53, 0x70, 
+	0xf9, 0xed, 0x54, 0xbd, 0x56, 0xe0, 0x59, 0xfb, 
+	0x5b, 0xc5, 0x5f, 0x15, 0x5f, 0xcd, 0x6e, 0x6e, 
+	0xf9, 0xee, 0xf9, 0xef, 0x7d, 0x6a, 0x83, 0x35, 
+	0xf9, 0xf0, 0x86, 0x93, 0x8a, 0x8d, 0xf9, 0xf1, 
+	0x97, 0x6d, 0x97, 0x77, 0xf9, 0xf2, 0xf9, 0xf3, 
+	0x4e, 0x00, 0x4f, 0x5a, 0x4f, 0x7e, 0x58, 0xf9, 
+	0x65, 0xe5, 0x6e, 0xa2, 0x90, 0x38, 0x93, 0xb0, 
+	0x99, 0xb9, 0x4e, 0xfb, 0x58, 0xec, 0x59, 0x8a, 
+	0x59, 0xd9, 0x60, 0x41, 0xf9, 0xf4, 0xf9, 0xf5, 
+	0x7a, 0x14, 0xf9, 0xf6, 0x83, 0x4f, 0x8c, 0xc3, 
+	0x51, 0x65, 0x53, 0x44, 0xf9, 0xf7, 0xf9, 0xf8, 
+	0xf9, 0xf9, 0x4e, 0xcd, 0x52, 0x69, 0x5b, 0x55, 
+	0x82, 0xbf, 0x4e, 0xd4, 0x52, 0x3a, 0x54, 0xa8, 
+	0x59, 0xc9, 0x59, 0xff, 0x5b, 0x50, 0x5b, 0x57, 
+	0x5b, 0x5c, 0x60, 0x63, 0x61, 0x48, 0x6e, 0xcb, 
+	0x70, 0x99, 0x71, 0x6e, 0x73, 0x86, 0x74, 0xf7, 
+	0x75, 0xb5, 0x78, 0xc1, 0x7d, 0x2b, 0x80, 0x05, 
+	0x81, 0xea, 0x83, 0x28, 0x85, 0x17, 0x85, 0xc9, 
+	0x8a, 0xee, 0x8c, 0xc7, 0x96, 0xcc, 0x4f, 0x5c, 
+	0x52, 0xfa, 0x56, 0xbc, 0x65, 0xab, 0x66, 0x28, 
+	0x70, 0x7c, 0x70, 0xb8, 0x72, 0x35, 0x7d, 0xbd, 
+	0x82, 0x8d, 0x91, 0x4c, 0x96, 0xc0, 0x9d, 0x72, 
+	0x5b, 0x71, 0x68, 0xe7, 0x6b, 0x98, 0x6f, 0x7a, 
+	0x76, 0xde, 0x5c, 0x91, 0x66, 0xab, 0x6f, 0x5b, 
+	0x7b, 0xb4, 0x7c, 0x2a, 0x88, 0x36, 0x96, 0xdc, 
+	0x4e, 0x08, 0x4e, 0xd7, 0x53, 0x20, 0x58, 0x34, 
+	0x58, 0xbb, 0x58, 0xef, 0x59, 0x6c, 0x5c, 0x07, 
+	0x5e, 0x33, 0x5e, 0x84, 0x5f, 0x35, 0x63, 0x8c, 
+	0x66, 0xb2, 0x67, 0x56, 0x6a, 0x1f, 0x6a, 0xa3, 
+	0x6b, 0x0c, 0x6f, 0x3f, 0x72, 0x46, 0xf9, 0xfa, 
+	0x73, 0x50, 0x74, 0x8b, 0x7a, 0xe0, 0x7c, 0xa7, 
+	0x81, 0x78, 0x81, 0xdf, 0x81, 0xe7, 0x83, 0x8a, 
+	0x84, 0x6c, 0x85, 0x23, 0x85, 0x94, 0x85, 0xcf, 
+	0x88, 0xdd, 0x8d, 0x13, 0x91, 0xac, 0x95, 0x77, 
+	0x96, 0x9c, 0x51, 0x8d, 0x54, 0xc9, 0x57, 0x28, 
+	0x5b, 0xb0, 0x62, 0x4d, 0x67, 0x50, 0x68, 0x3d, 
+	0x68, 0x93, 0x6e, 0x3d, 0x6e, 0xd3, 0x70, 0x7d, 
+	0x7e, 0x21, 0x88, 0xc1, 0x8c, 0xa1, 0x8f, 0x09, 
+	0x9f, 0x4b, 0x9f, 0x4e, 0x72, 0x2d, 0x7b, 0x8f, 
+	0x8a, 0xcd, 0x93, 0x1a, 0x4f, 0x47, 0x4f, 0x4e, 
+	0x51, 0x32, 0x54, 0x80, 0x59, 0xd0, 0x5e, 0x95, 
+	0x62, 0xb5, 0x67, 0x75, 0x69, 0x6e, 0x6a, 0x17, 
+	0x6c, 0xae, 0x6e, 0x1a, 0x72, 0xd9, 0x73, 0x2a, 
+	0x75, 0xbd, 0x7b, 0xb8, 0x7d, 0x35, 0x82, 0xe7, 
+	0x83, 0xf9, 0x84, 0x57, 0x85, 0xf7, 0x8a, 0x5b, 
+	0x8c, 0xaf, 0x8e, 0x87, 0x90, 0x19, 0x90, 0xb8, 
+	0x96, 0xce, 0x9f, 0x5f, 0x52, 0xe3, 0x54, 0x0a, 
+	0x5a, 0xe1, 0x5b, 0xc2, 0x64, 0x58, 0x65, 0x75, 
+	0x6e, 0xf4, 0x72, 0xc4, 0xf9, 0xfb, 0x76, 0x84, 
+	0x7a, 0x4d, 0x7b, 0x1b, 0x7c, 0x4d, 0x7e, 0x3e, 
+	0x7f, 0xdf, 0x83, 0x7b, 0x8b, 0x2b, 0x8c, 0xca, 
+	0x8d, 0x64, 0x8d, 0xe1, 0x8e, 0x5f, 0x8f, 0xea, 
+	0x8f, 0xf9, 0x90, 0x69, 0x93, 0xd1, 0x4f, 0x43, 
+	0x4f, 0x7a, 0x50, 0xb3, 0x51, 0x68, 0x51, 0x78, 
+	0x52, 0x4d, 0x52, 0x6a, 0x58, 0x61, 0x58, 0x7c, 
+	0x59, 0x60, 0x5c, 0x08, 0x5c, 0x55, 0x5e, 0xdb, 
+	0x60, 0x9b, 0x62, 0x30, 0x68, 0x13, 0x6b, 0xbf, 
+	0x6c, 0x08, 0x6f, 0xb1, 0x71, 0x4e, 0x74, 0x20, 
+	0x75, 0x30, 0x75, 0x38, 0x75, 0x51, 0x76, 0x72, 
+	0x7b, 0x4c, 0x7b, 0x8b, 0x7b, 0xad, 0x7b, 0xc6, 
+	0x7e, 0x8f, 0x8a, 0x6e, 0x8f, 0x3e, 0x8f, 0x49, 
+	0x92, 0x3f, 0x92, 0x93, 0x93, 0x22, 0x94, 0x2b, 
+	0x96, 0xfb, 0x98, 0x5a, 0x98, 0x6b, 0x99, 0x1e, 
+	0x52, 0x07, 0x62, 0x2a, 0x62, 0x98, 0x6d, 0x59, 
+	0x76, 0x64, 0x7a, 0xca, 0x7b, 0xc0, 0x7d, 0x76, 
+	0x53, 0x60, 0x5c, 0xbe, 0x5e, 0x97, 0x6f, 0x38, 
+	0x70, 0xb9, 0x7c, 0x98, 0x97, 0x11, 0x9b, 0x8e, 
+	0x9e, 0xde, 0x63, 0xa5, 0x64, 0x7a, 0x87, 0x76, 
+	0x4e, 0x01, 0x4e, 0x95, 0x4e, 0xad, 0x50, 0x5c, 
+	0x50, 0x75, 0x54, 0x48, 0x59, 0xc3, 0x5b, 0x9a, 
+	0x5e, 0x40, 0x5e, 0xad, 0x5e, 0xf7, 0x5f, 0x81, 
+	0x60, 0xc5, 0x63, 0x3a, 0x65, 0x3f, 0x65, 0x74, 
+	0x65, 0xcc, 0x66, 0x76, 0x66, 0x78, 0x67, 0xfe, 
+	0x69, 0x68, 0x6a, 0x89, 0x6b, 0x63, 0x6c, 0x40, 
+	0x6d, 0xc0, 0x6d, 0xe8, 0x6e, 0x1f, 0x6e, 0x5e, 
+	0x70, 0x1e, 0x70, 0xa1, 0x73, 0x8e, 0x73, 0xfd, 
+	0x75, 0x3a, 0x77, 0x5b, 0x78, 0x87, 0x79, 0x8e, 
+	0x7a, 0x0b, 0x7a, 0x7d, 0x7c, 0xbe, 0x7d, 0x8e, 
+	0x82, 0x47, 0x8a, 0x02, 0x8a, 0xea, 0x8c, 0x9e, 
+	0x91, 0x2d, 0x91, 0x4a, 0x91, 0xd8, 0x92, 0x66, 
+	0x92, 0xcc, 0x93, 0x20, 0x97, 0x06, 0x97, 0x56, 
+	0x97, 0x5c, 0x98, 0x02, 0x9f, 0x0e, 0x52, 0x36, 
+	0x52, 0x91, 0x55, 0x7c, 0x58, 0x24, 0x5e, 0x1d, 
+	0x5f, 0x1f, 0x60, 0x8c, 0x63, 0xd0, 0x68, 0xaf, 
+	0x6f, 0xdf, 0x79, 0x6d, 0x7b, 0x2c, 0x81, 0xcd, 
+	0x85, 0xba, 0x88, 0xfd, 0x8a, 0xf8, 0x8e, 0x44, 
+	0x91, 0x8d, 0x96, 0x64, 0x96, 0x9b, 0x97, 0x3d, 
+	0x98, 0x4c, 0x9f, 0x4a, 0x4f, 0xce, 0x51, 0x46, 
+	0x51, 0xcb, 0x52, 0xa9, 0x56, 0x32, 0x5f, 0x14, 
+	0x5f, 0x6b, 0x63, 0xaa, 0x64, 0xcd, 0x65, 0xe9, 
+	0x66, 0x41, 0x66, 0xfa, 0x66, 0xf9, 0x67, 0x1d, 
+	0x68, 0x9d, 0x68, 0xd7, 0x69, 0xfd, 0x6f, 0x15, 
+	0x6f, 0x6e, 0x71, 0x67, 0x71, 0xe5, 0x72, 0x2a, 
+	0x74, 0xaa, 0x77, 0x3a, 0x79, 0x56, 0x79, 0x5a, 
+	0x79, 0xdf, 0x7a, 0x20, 0x7a, 0x95, 0x7c, 0x97, 
+	0x7c, 0xdf, 0x7d, 0x44, 0x7e, 0x70, 0x80, 0x87, 
+	0x85, 0xfb, 0x86, 0xa4, 0x8a, 0x54, 0x8a, 0xbf, 
+	0x8d, 0x99, 0x8e, 0x81, 0x90, 0x20, 0x90, 0x6d, 
+	0x91, 0xe3, 0x96, 0x3b, 0x96, 0xd5, 0x9c, 0xe5, 
+	0x65, 0xcf, 0x7c, 0x07, 0x8d, 0xb3, 0x93, 0xc3, 
+	0x5b, 0x58, 0x5c, 0x0a, 0x53, 0x52, 0x62, 0xd9, 
+	0x73, 0x1d, 0x50, 0x27, 0x5b, 0x97, 0x5f, 0x9e, 
+	0x60, 0xb0, 0x61, 0x6b, 0x68, 0xd5, 0x6d, 0xd9, 
+	0x74, 0x2e, 0x7a, 0x2e, 0x7d, 0x42, 0x7d, 0x9c, 
+	0x7e, 0x31, 0x81, 0x6b, 0x8e, 0x2a, 0x8e, 0x35, 
+	0x93, 0x7e, 0x94, 0x18, 0x4f, 0x50, 0x57, 0x50, 
+	0x5d, 0xe6, 0x5e, 0xa7, 0x63, 0x2b, 0x7f, 0x6a, 
+	0x4e, 0x3b, 0x4f, 0x4f, 0x4f, 0x8f, 0x50, 0x5a, 
+	0x59, 0xdd, 0x80, 0xc4, 0x54, 0x6a, 0x54, 0x68, 
+	0x55, 0xfe, 0x59, 0x4f, 0x5b, 0x99, 0x5d, 0xde, 
+	0x5e, 0xda, 0x66, 0x5d, 0x67, 0x31, 0x67, 0xf1, 
+	0x68, 0x2a, 0x6c, 0xe8, 0x6d, 0x32, 0x6e, 0x4a, 
+	0x6f, 0x8d, 0x70, 0xb7, 0x73, 0xe0, 0x75, 0x87, 
+	0x7c, 0x4c, 0x7d, 0x02, 0x7d, 0x2c, 0x7d, 0xa2, 
+	0x82, 0x1f, 0x86, 0xdb, 0x8a, 0x3b, 0x8a, 0x85, 
+	0x8d, 0x70, 0x8e, 0x8a, 0x8f, 0x33, 0x90, 0x31, 
+	0x91, 0x4e, 0x91, 0x52, 0x94, 0x44, 0x99, 0xd0, 
+	0x7a, 0xf9, 0x7c, 0xa5, 0x4f, 0xca, 0x51, 0x01, 
+	0x51, 0xc6, 0x57, 0xc8, 0x5b, 0xef, 0x5c, 0xfb, 
+	0x66, 0x59, 0x6a, 0x3d, 0x6d, 0x5a, 0x6e, 0x96, 
+	0x6f, 0xec, 0x71, 0x0c, 0x75, 0x6f, 0x7a, 0xe3, 
+	0x88, 0x22, 0x90, 0x21, 0x90, 0x75, 0x96, 0xcb, 
+	0x99, 0xff, 0x83, 0x01, 0x4e, 0x2d, 0x4e, 0xf2, 
+	0x88, 0x46, 0x91, 0xcd, 0x53, 0x7d, 0x6a, 0xdb, 
+	0x69, 0x6b, 0x6c, 0x41, 0x84, 0x7a, 0x58, 0x9e, 
+	0x61, 0x8e, 0x66, 0xfe, 0x62, 0xef, 0x70, 0xdd, 
+	0x75, 0x11, 0x75, 0xc7, 0x7e, 0x52, 0x84, 0xb8, 
+	0x8b, 0x49, 0x8d, 0x08, 0x4e, 0x4b, 0x53, 0xea, 
+	0x54, 0xab, 0x57, 0x30, 0x57, 0x40, 0x5f, 0xd7, 
+	0x63, 0x01, 0x63, 0x07, 0x64, 0x6f, 0x65, 0x2f, 
+	0x65, 0xe8, 0x66, 0x7a, 0x67, 0x9d, 0x67, 0xb3, 
+	0x6b, 0x62, 0x6c, 0x60, 0x6c, 0x9a, 0x6f, 0x2c, 
+	0x77, 0xe5, 0x78, 0x25, 0x79, 0x49, 0x79, 0x57, 
+	0x7d, 0x19, 0x80, 0xa2, 0x81, 0x02, 0x81, 0xf3, 
+	0x82, 0x9d, 0x82, 0xb7, 0x87, 0x18, 0x8a, 0x8c, 
+	0xf9, 0xfc, 0x8d, 0x04, 0x8d, 0xbe, 0x90, 0x72, 
+	0x76, 0xf4, 0x7a, 0x19, 0x7a, 0x37, 0x7e, 0x54, 
+	0x80, 0x77, 0x55, 0x07, 0x55, 0xd4, 0x58, 0x75, 
+	0x63, 0x2f, 0x64, 0x22, 0x66, 0x49, 0x66, 0x4b, 
+	0x68, 0x6d, 0x69, 0x9b, 0x6b, 0x84, 0x6d, 0x25, 
+	0x6e, 0xb1, 0x73, 0xcd, 0x74, 0x68, 0x74, 0xa1, 
+	0x75, 0x5b, 0x75, 0xb9, 0x76, 0xe1, 0x77, 0x1e, 
+	0x77, 0x8b, 0x79, 0xe6, 0x7e, 0x09, 0x7e, 0x1d, 
+	0x81, 0xfb, 0x85, 0x2f, 0x88, 0x97, 0x8a, 0x3a, 
+	0x8c, 0xd1, 0x8e, 0xeb, 0x8f, 0xb0, 0x90, 0x32, 
+	0x93, 0xad, 0x96, 0x63, 0x96, 0x73, 0x97, 0x07, 
+	0x4f, 0x84, 0x53, 0xf1, 0x59, 0xea, 0x5a, 0xc9, 
+	0x5e, 0x19, 0x68, 0x4e, 0x74, 0xc6, 0x75, 0xbe, 
+	0x79, 0xe9, 0x7a, 0x92, 0x81, 0xa3, 0x86, 0xed, 
+	0x8c, 0xea, 0x8d, 0xcc, 0x8f, 0xed, 0x65, 0x9f, 
+	0x67, 0x15, 0xf9, 0xfd, 0x57, 0xf7, 0x6f, 0x57, 
+	0x7d, 0xdd, 0x8f, 0x2f, 0x93, 0xf6, 0x96, 0xc6, 
+	0x5f, 0xb5, 0x61, 0xf2, 0x6f, 0x84, 0x4e, 0x14, 
+	0x4f, 0x98, 0x50, 0x1f, 0x53, 0xc9, 0x55, 0xdf, 
+	0x5d, 0x6f, 0x5d, 0xee, 0x6b, 0x21, 0x6b, 0x64, 
+	0x78, 0xcb, 0x7b, 0x9a, 0xf9, 0xfe, 0x8e, 0x49, 
+	0x8e, 0xca, 0x90, 0x6e, 0x63, 0x49, 0x64, 0x3e, 
+	0x77, 0x40, 0x7a, 0x84, 0x93, 0x2f, 0x94, 0x7f, 
+	0x9f, 0x6a, 0x64, 0xb0, 0x6f, 0xaf, 0x71, 0xe6, 
+	0x74, 0xa8, 0x74, 0xda, 0x7a, 0xc4, 0x7c, 0x12, 
+	0x7e, 0x82, 0x7c, 0xb2, 0x7e, 0x98, 0x8b, 0x9a, 
+	0x8d, 0x0a, 0x94, 0x7d, 0x99, 0x10, 0x99, 0x4c, 
+	0x52, 0x39, 0x5b, 0xdf, 0x64, 0xe6, 0x67, 0x2d, 
+	0x7d, 0x2e, 0x50, 0xed, 0x53, 0xc3, 0x58, 0x79, 
+	0x61, 0x58, 0x61, 0x59, 0x61, 0xfa, 0x65, 0xac, 
+	0x7a, 0xd9, 0x8b, 0x92, 0x8b, 0x96, 0x50, 0x09, 
+	0x50, 0x21, 0x52, 0x75, 0x55, 0x31, 0x5a, 0x3c, 
+	0x5e, 0xe0, 0x5f, 0x70, 0x61, 0x34, 0x65, 0x5e, 
+	0x66, 0x0c, 0x66, 0x36, 0x66, 0xa2, 0x69, 0xcd, 
+	0x6e, 0xc4, 0x6f, 0x32, 0x73, 0x16, 0x76, 0x21, 
+	0x7a, 0x93, 0x81, 0x39, 0x82, 0x59, 0x83, 0xd6, 
+	0x84, 0xbc, 0x50, 0xb5, 0x57, 0xf0, 0x5b, 0xc0, 
+	0x5b, 0xe8, 0x5f, 0x69, 0x63, 0xa1, 0x78, 0x26, 
+	0x7d, 0xb5, 0x83, 0xdc, 0x85, 0x21, 0x91, 0xc7, 
+	0x91, 0xf5, 0x51, 0x8a, 0x67, 0xf5, 0x7b, 0x56, 
+	0x8c, 0xac, 0x51, 0xc4, 0x59, 0xbb, 0x60, 0xbd, 
+	0x86, 0x55, 0x50, 0x1c, 0xf9, 0xff, 0x52, 0x54, 
+	0x5c, 0x3a, 0x61, 0x7d, 0x62, 0x1a, 0x62, 0xd3, 
+	0x64, 0xf2, 0x65, 0xa5, 0x6e, 0xcc, 0x76, 0x20, 
+	0x81, 0x0a, 0x8e, 0x60, 0x96, 0x5f, 0x96, 0xbb, 
+	0x4e, 0xdf, 0x53, 0x43, 0x55, 0x98, 0x59, 0x29, 
+	0x5d, 0xdd, 0x64, 0xc5, 0x6c, 0xc9, 0x6d, 0xfa, 
+	0x73, 0x94, 0x7a, 0x7f, 0x82, 0x1b, 0x85, 0xa6, 
+	0x8c, 0xe4, 0x8e, 0x10, 0x90, 0x77, 0x91, 0xe7, 
+	0x95, 0xe1, 0x96, 0x21, 0x97, 0xc6, 0x51, 0xf8, 
+	0x54, 0xf2, 0x55, 0x86, 0x5f, 0xb9, 0x64, 0xa4, 
+	0x6f, 0x88, 0x7d, 0xb4, 0x8f, 0x1f, 0x8f, 0x4d, 
+	0x94, 0x35, 0x50, 0xc9, 0x5c, 0x16, 0x6c, 0xbe, 
+	0x6d, 0xfb, 0x75, 0x1b, 0x77, 0xbb, 0x7c, 0x3d, 
+	0x7c, 0x64, 0x8a, 0x79, 0x8a, 0xc2, 0x58, 0x1e, 
+	0x59, 0xbe, 0x5e, 0x16, 0x63, 0x77, 0x72, 0x52, 
+	0x75, 0x8a, 0x77, 0x6b, 0x8a, 0xdc, 0x8c, 0xbc, 
+	0x8f, 0x12, 0x5e, 0xf3, 0x66, 0x74, 0x6d, 0xf8, 
+	0x80, 0x7d, 0x83, 0xc1, 0x8a, 0xcb, 0x97, 0x51, 
+	0x9b, 0xd6, 0xfa, 0x00, 0x52, 0x43, 0x66, 0xff, 
+	0x6d, 0x95, 0x6e, 0xef, 0x7d, 0xe0, 0x8a, 0xe6, 
+	0x90, 0x2e, 0x90, 0x5e, 0x9a, 0xd4, 0x52, 0x1d, 
+	0x52, 0x7f, 0x54, 0xe8, 0x61, 0x94, 0x62, 0x84, 
+	0x62, 0xdb, 0x68, 0xa2, 0x69, 0x12, 0x69, 0x5a, 
+	0x6a, 0x35, 0x70, 0x92, 0x71, 0x26, 0x78, 0x5d, 
+	0x79, 0x01, 0x79, 0x0e, 0x79, 0xd2, 0x7a, 0x0d, 
+	0x80, 0x96, 0x82, 0x78, 0x82, 0xd5, 0x83, 0x49, 
+	0x85, 0x49, 0x8c, 0x82, 0x8d, 0x85, 0x91, 0x62, 
+	0x91, 0x8b, 0x91, 0xae, 0x4f, 0xc3, 0x56, 0xd1, 
+	0x71, 0xed, 0x77, 0xd7, 0x87, 0x00, 0x89, 0xf8, 
+	0x5b, 0xf8, 0x5f, 0xd6, 0x67, 0x51, 0x90, 0xa8, 
+	0x53, 0xe2, 0x58, 0x5a, 0x5b, 0xf5, 0x60, 0xa4, 
+	0x61, 0x81, 0x64, 0x60, 0x7e, 0x3d, 0x80, 0x70, 
+	0x85, 0x25, 0x92, 0x83, 0x64, 0xae, 0x50, 0xac, 
+	0x5d, 0x14, 0x67, 0x00, 0x58, 0x9c, 0x62, 0xbd, 
+	0x63, 0xa8, 0x69, 0x0e, 0x69, 0x78, 0x6a, 0x1e, 
+	0x6e, 0x6b, 0x76, 0xba, 0x79, 0xcb, 0x82, 0xbb, 
+	0x84, 0x29, 0x8a, 0xcf, 0x8d, 0xa8, 0x8f, 0xfd, 
+	0x91, 0x12, 0x91, 0x4b, 0x91, 0x9c, 0x93, 0x10, 
+	0x93, 0x18, 0x93, 0x9a, 0x96, 0xdb, 0x9a, 0x36, 
+	0x9c, 0x0d, 0x4e, 0x11, 0x75, 0x5c, 0x79, 0x5d, 
+	0x7a, 0xfa, 0x7b, 0x51, 0x7b, 0xc9, 0x7e, 0x2e, 
+	0x84, 0xc4, 0x8e, 0x59, 0x8e, 0x74, 0x8e, 0xf8, 
+	0x90, 0x10, 0x66, 0x25, 0x69, 0x3f, 0x74, 0x43, 
+	0x51, 0xfa, 0x67, 0x2e, 0x9e, 0xdc, 0x51, 0x45, 
+	0x5f, 0xe0, 0x6c, 0x96, 0x87, 0xf2, 0x88, 0x5d, 
+	0x88, 0x77, 0x60, 0xb4, 0x81, 0xb5, 0x84, 0x03, 
+	0x8d, 0x05, 0x53, 0xd6, 0x54, 0x39, 0x56, 0x34, 
+	0x5a, 0x36, 0x5c, 0x31, 0x70, 0x8a, 0x7f, 0xe0, 
+	0x80, 0x5a, 0x81, 0x06, 0x81, 0xed, 0x8d, 0xa3, 
+	0x91, 0x89, 0x9a, 0x5f, 0x9d, 0xf2, 0x50, 0x74, 
+	0x4e, 0xc4, 0x53, 0xa0, 0x60, 0xfb, 0x6e, 0x2c, 
+	0x5c, 0x64, 0x4f, 0x88, 0x50, 0x24, 0x55, 0xe4, 
+	0x5c, 0xd9, 0x5e, 0x5f, 0x60, 0x65, 0x68, 0x94, 
+	0x6c, 0xbb, 0x6d, 0xc4, 0x71, 0xbe, 0x75, 0xd4, 
+	0x75, 0xf4, 0x76, 0x61, 0x7a, 0x1a, 0x7a, 0x49, 
+	0x7d, 0xc7, 0x7d, 0xfb, 0x7f, 0x6e, 0x81, 0xf4, 
+	0x86, 0xa9, 0x8f, 0x1c, 0x96, 0xc9, 0x99, 0xb3, 
+	0x9f, 0x52, 0x52, 0x47, 0x52, 0xc5, 0x98, 0xed, 
+	0x89, 0xaa, 0x4e, 0x03, 0x67, 0xd2, 0x6f, 0x06, 
+	0x4f, 0xb5, 0x5b, 0xe2, 0x67, 0x95, 0x6c, 0x88, 
+	0x6d, 0x78, 0x74, 0x1b, 0x78, 0x27, 0x91, 0xdd, 
+	0x93, 0x7c, 0x87, 0xc4, 0x79, 0xe4, 0x7a, 0x31, 
+	0x5f, 0xeb, 0x4e, 0xd6, 0x54, 0xa4, 0x55, 0x3e, 
+	0x58, 0xae, 0x59, 0xa5, 0x60, 0xf0, 0x62, 0x53, 
+	0x62, 0xd6, 0x67, 0x36, 0x69, 0x55, 0x82, 0x35, 
+	0x96, 0x40, 0x99, 0xb1, 0x99, 0xdd, 0x50, 0x2c, 
+	0x53, 0x53, 0x55, 0x44, 0x57, 0x7c, 0xfa, 0x01, 
+	0x62, 0x58, 0xfa, 0x02, 0x64, 0xe2, 0x66, 0x6b, 
+	0x67, 0xdd, 0x6f, 0xc1, 0x6f, 0xef, 0x74, 0x22, 
+	0x74, 0x38, 0x8a, 0x17, 0x94, 0x38, 0x54, 0x51, 
+	0x56, 0x06, 0x57, 0x66, 0x5f, 0x48, 0x61, 0x9a, 
+	0x6b, 0x4e, 0x70, 0x58, 0x70, 0xad, 0x7d, 0xbb, 
+	0x8a, 0x95, 0x59, 0x6a, 0x81, 0x2b, 0x63, 0xa2, 
+	0x77, 0x08, 0x80, 0x3d, 0x8c, 0xaa, 0x58, 0x54, 
+	0x64, 0x2d, 0x69, 0xbb, 0x5b, 0x95, 0x5e, 0x11, 
+	0x6e, 0x6f, 0xfa, 0x03, 0x85, 0x69, 0x51, 0x4c, 
+	0x53, 0xf0, 0x59, 0x2a, 0x60, 0x20, 0x61, 0x4b, 
+	0x6b, 0x86, 0x6c, 0x70, 0x6c, 0xf0, 0x7b, 0x1e, 
+	0x80, 0xce, 0x82, 0xd4, 0x8d, 0xc6, 0x90, 0xb0, 
+	0x98, 0xb1, 0xfa, 0x04, 0x64, 0xc7, 0x6f, 0xa4, 
+	0x64, 0x91, 0x65, 0x04, 0x51, 0x4e, 0x54, 0x10, 
+	0x57, 0x1f, 0x8a, 0x0e, 0x61, 0x5f, 0x68, 0x76, 
+	0xfa, 0x05, 0x75, 0xdb, 0x7b, 0x52, 0x7d, 0x71, 
+	0x90, 0x1a, 0x58, 0x06, 0x69, 0xcc, 0x81, 0x7f, 
+	0x89, 0x2a, 0x90, 0x00, 0x98, 0x39, 0x50, 0x78, 
+	0x59, 0x57, 0x59, 0xac, 0x62, 0x95, 0x90, 0x0f, 
+	0x9b, 0x2a, 0x61, 0x5d, 0x72, 0x79, 0x95, 0xd6, 
+	0x57, 0x61, 0x5a, 0x46, 0x5d, 0xf4, 0x62, 0x8a, 
+	0x64, 0xad, 0x64, 0xfa, 0x67, 0x77, 0x6c, 0xe2, 
+	0x6d, 0x3e, 0x72, 0x2c, 0x74, 0x36, 0x78, 0x34, 
+	0x7f, 0x77, 0x82, 0xad, 0x8d, 0xdb, 0x98, 0x17, 
+	0x52, 0x24, 0x57, 0x42, 0x67, 0x7f, 0x72, 0x48, 
+	0x74, 0xe3, 0x8c, 0xa9, 0x8f, 0xa6, 0x92, 0x11, 
+	0x96, 0x2a, 0x51, 0x6b, 0x53, 0xed, 0x63, 0x4c, 
+	0x4f, 0x69, 0x55, 0x04, 0x60, 0x96, 0x65, 0x57, 
+	0x6c, 0x9b, 0x6d, 0x7f, 0x72, 0x4c, 0x72, 0xfd, 
+	0x7a, 0x17, 0x89, 0x87, 0x8c, 0x9d, 0x5f, 0x6d, 
+	0x6f, 0x8e, 0x70, 0xf9, 0x81, 0xa8, 0x61, 0x0e, 
+	0x4f, 0xbf, 0x50, 0x4f, 0x62, 0x41, 0x72, 0x47, 
+	0x7b, 0xc7, 0x7d, 0xe8, 0x7f, 0xe9, 0x90, 0x4d, 
+	0x97, 0xad, 0x9a, 0x19, 0x8c, 0xb6, 0x57, 0x6a, 
+	0x5e, 0x73, 0x67, 0xb0, 0x84, 0x0d, 0x8a, 0x55, 
+	0x54, 0x20, 0x5b, 0x16, 0x5e, 0x63, 0x5e, 0xe2, 
+	0x5f, 0x0a, 0x65, 0x83, 0x80, 0xba, 0x85, 0x3d, 
+	0x95, 0x89, 0x96, 0x5b, 0x4f, 0x48, 0x53, 0x05, 
+	0x53, 0x0d, 0x53, 0x0f, 0x54, 0x86, 0x54, 0xfa, 
+	0x57, 0x03, 0x5e, 0x03, 0x60, 0x16, 0x62, 0x9b, 
+	0x62, 0xb1, 0x63, 0x55, 0xfa, 0x06, 0x6c, 0xe1, 
+	0x6d, 0x66, 0x75, 0xb1, 0x78, 0x32, 0x80, 0xde, 
+	0x81, 0x2f, 0x82, 0xde, 0x84, 0x61, 0x84, 0xb2, 
+	0x88, 0x8d, 0x89, 0x12, 0x90, 0x0b, 0x92, 0xea, 
+	0x98, 0xfd, 0x9b, 0x91, 0x5e, 0x45, 0x66, 0xb4, 
+	0x66, 0xdd, 0x70, 0x11, 0x72, 0x06, 0xfa, 0x07, 
+	0x4f, 0xf5, 0x52, 0x7d, 0x5f, 0x6a, 0x61, 0x53, 
+	0x67, 0x53, 0x6a, 0x19, 0x6f, 0x02, 0x74, 0xe2, 
+	0x79, 0x68, 0x88, 0x68, 0x8c, 0x79, 0x98, 0xc7, 
+	0x98, 0xc4, 0x9a, 0x43, 0x54, 0xc1, 0x7a, 0x1f, 
+	0x69, 0x53, 0x8a, 0xf7, 0x8c, 0x4a, 0x98, 0xa8, 
+	0x99, 0xae, 0x5f, 0x7c, 0x62, 0xab, 0x75, 0xb2, 
+	0x76, 0xae, 0x88, 0xab, 0x90, 0x7f, 0x96, 0x42, 
+	0x53, 0x39, 0x5f, 0x3c, 0x5f, 0xc5, 0x6c, 0xcc, 
+	0x73, 0xcc, 0x75, 0x62, 0x75, 0x8b, 0x7b, 0x46, 
+	0x82, 0xfe, 0x99, 0x9d, 0x4e, 0x4f, 0x90, 0x3c, 
+	0x4e, 0x0b, 0x4f, 0x55, 0x53, 0xa6, 0x59, 0x0f, 
+	0x5e, 0xc8, 0x66, 0x30, 0x6c, 0xb3, 0x74, 0x55, 
+	0x83, 0x77, 0x87, 0x66, 0x8c, 0xc0, 0x90, 0x50, 
+	0x97, 0x1e, 0x9c, 0x15, 0x58, 0xd1, 0x5b, 0x78, 
+	0x86, 0x50, 0x8b, 0x14, 0x9d, 0xb4, 0x5b, 0xd2, 
+	0x60, 0x68, 0x60, 0x8d, 0x65, 0xf1, 0x6c, 0x57, 
+	0x6f, 0x22, 0x6f, 0xa3, 0x70, 0x1a, 0x7f, 0x55, 
+	0x7f, 0xf0, 0x95, 0x91, 0x95, 0x92, 0x96, 0x50, 
+	0x97, 0xd3, 0x52, 0x72, 0x8f, 0x44, 0x51, 0xfd, 
+	0x54, 0x2b, 0x54, 0xb8, 0x55, 0x63, 0x55, 0x8a, 
+	0x6a, 0xbb, 0x6d, 0xb5, 0x7d, 0xd8, 0x82, 0x66, 
+	0x92, 0x9c, 0x96, 0x77, 0x9e, 0x79, 0x54, 0x08, 
+	0x54, 0xc8, 0x76, 0xd2, 0x86, 0xe4, 0x95, 0xa4, 
+	0x95, 0xd4, 0x96, 0x5c, 0x4e, 0xa2, 0x4f, 0x09, 
+	0x59, 0xee, 0x5a, 0xe6, 0x5d, 0xf7, 0x60, 0x52, 
+	0x62, 0x97, 0x67, 0x6d, 0x68, 0x41, 0x6c, 0x86, 
+	0x6e, 0x2f, 0x7f, 0x38, 0x80, 0x9b, 0x82, 0x2a, 
+	0xfa, 0x08, 0xfa, 0x09, 0x98, 0x05, 0x4e, 0xa5, 
+	0x50, 0x55, 0x54, 0xb3, 0x57, 0x93, 0x59, 0x5a, 
+	0x5b, 0x69, 0x5b, 0xb3, 0x61, 0xc8, 0x69, 0x77, 
+	0x6d, 0x77, 0x70, 0x23, 0x87, 0xf9, 0x89, 0xe3, 
+	0x8a, 0x72, 0x8a, 0xe7, 0x90, 0x82, 0x99, 0xed, 
+	0x9a, 0xb8, 0x52, 0xbe, 0x68, 0x38, 0x50, 0x16, 
+	0x5e, 0x78, 0x67, 0x4f, 0x83, 0x47, 0x88, 0x4c, 
+	0x4e, 0xab, 0x54, 0x11, 0x56, 0xae, 0x73, 0xe6, 
+	0x91, 0x15, 0x97, 0xff, 0x99, 0x09, 0x99, 0x57, 
+	0x99, 0x99, 0x56, 0x53, 0x58, 0x9f, 0x86, 0x5b, 
+	0x8a, 0x31, 0x61, 0xb2, 0x6a, 0xf6, 0x73, 0x7b, 
+	0x8e, 0xd2, 0x6b, 0x47, 0x96, 0xaa, 0x9a, 0x57, 
+	0x59, 0x55, 0x72, 0x00, 0x8d, 0x6b, 0x97, 0x69, 
+	0x4f, 0xd4, 0x5c, 0xf4, 0x5f, 0x26, 0x61, 0xf8, 
+	0x66, 0x5b, 0x6c, 0xeb, 0x70, 0xab, 0x73, 0x84, 
+	0x73, 0xb9, 0x73, 0xfe, 0x77, 0x29, 0x77, 0x4d, 
+	0x7d, 0x43, 0x7d, 0x62, 0x7e, 0x23, 0x82, 0x37, 
+	0x88, 0x52, 0xfa, 0x0a, 0x8c, 0xe2, 0x92, 0x49, 
+	0x98, 0x6f, 0x5b, 0x51, 0x7a, 0x74, 0x88, 0x40, 
+	0x98, 0x01, 0x5a, 0xcc, 0x4f, 0xe0, 0x53, 0x54, 
+	0x59, 0x3e, 0x5c, 0xfd, 0x63, 0x3e, 0x6d, 0x79, 
+	0x72, 0xf9, 0x81, 0x05, 0x81, 0x07, 0x83, 0xa2, 
+	0x92, 0xcf, 0x98, 0x30, 0x4e, 0xa8, 0x51, 0x44, 
+	0x52, 0x11, 0x57, 0x8b, 0x5f, 0x62, 0x6c, 0xc2, 
+	0x6e, 0xce, 0x70, 0x05, 0x70, 0x50, 0x70, 0xaf, 
+	0x71, 0x92, 0x73, 0xe9, 0x74, 0x69, 0x83, 0x4a, 
+	0x87, 0xa2, 0x88, 0x61, 0x90, 0x08, 0x90, 0xa2, 
+	0x93, 0xa3, 0x99, 0xa8, 0x51, 0x6e, 0x5f, 0x57, 
+	0x60, 0xe0, 0x61, 0x67, 0x66, 0xb3, 0x85, 0x59, 
+	0x8e, 0x4a, 0x91, 0xaf, 0x97, 0x8b, 0x4e, 0x4e, 
+	0x4e, 0x92, 0x54, 0x7c, 0x58, 0xd5, 0x58, 0xfa, 
+	0x59, 0x7d, 0x5c, 0xb5, 0x5f, 0x27, 0x62, 0x36, 
+	0x62, 0x48, 0x66, 0x0a, 0x66, 0x67, 0x6b, 0xeb, 
+	0x6d, 0x69, 0x6d, 0xcf, 0x6e, 0x56, 0x6e, 0xf8, 
+	0x6f, 0x94, 0x6f, 0xe0, 0x6f, 0xe9, 0x70, 0x5d, 
+	0x72, 0xd0, 0x74, 0x25, 0x74, 0x5a, 0x74, 0xe0, 
+	0x76, 0x93, 0x79, 0x5c, 0x7c, 0xca, 0x7e, 0x1e, 
+	0x80, 0xe1, 0x82, 0xa6, 0x84, 0x6b, 0x84, 0xbf, 
+	0x86, 0x4e, 0x86, 0x5f, 0x87, 0x74, 0x8b, 0x77, 
+	0x8c, 0x6a, 0x93, 0xac, 0x98, 0x00, 0x98, 0x65, 
+	0x60, 0xd1, 0x62, 0x16, 0x91, 0x77, 0x5a, 0x5a, 
+	0x66, 0x0f, 0x6d, 0xf7, 0x6e, 0x3e, 0x74, 0x3f, 
+	0x9b, 0x42, 0x5f, 0xfd, 0x60, 0xda, 0x7b, 0x0f, 
+	0x54, 0xc4, 0x5f, 0x18, 0x6c, 0x5e, 0x6c, 0xd3, 
+	0x6d, 0x2a, 0x70, 0xd8, 0x7d, 0x05, 0x86, 0x79, 
+	0x8a, 0x0c, 0x9d, 0x3b, 0x53, 0x16, 0x54, 0x8c, 
+	0x5b, 0x05, 0x6a, 0x3a, 0x70, 0x6b, 0x75, 0x75, 
+	0x79, 0x8d, 0x79, 0xbe, 0x82, 0xb1, 0x83, 0xef, 
+	0x8a, 0x71, 0x8b, 0x41, 0x8c, 0xa8, 0x97, 0x74, 
+	0xfa, 0x0b, 0x64, 0xf4, 0x65, 0x2b, 0x78, 0xba, 
+	0x78, 0xbb, 0x7a, 0x6b, 0x4e, 0x38, 0x55, 0x9a, 
+	0x59, 0x50, 0x5b, 0xa6, 0x5e, 0x7b, 0x60, 0xa3, 
+	0x63, 0xdb, 0x6b, 0x61, 0x66, 0x65, 0x68, 0x53, 
+	0x6e, 0x19, 0x71, 0x65, 0x74, 0xb0, 0x7d, 0x08, 
+	0x90, 0x84, 0x9a, 0x69, 0x9c, 0x25, 0x6d, 0x3b, 
+	0x6e, 0xd1, 0x73, 0x3e, 0x8c, 0x41, 0x95, 0xca, 
+	0x51, 0xf0, 0x5e, 0x4c, 0x5f, 0xa8, 0x60, 0x4d, 
+	0x60, 0xf6, 0x61, 0x30, 0x61, 0x4c, 0x66, 0x43, 
+	0x66, 0x44, 0x69, 0xa5, 0x6c, 0xc1, 0x6e, 0x5f, 
+	0x6e, 0xc9, 0x6f, 0x62, 0x71, 0x4c, 0x74, 0x9c, 
+	0x76, 0x87, 0x7b, 0xc1, 0x7c, 0x27, 0x83, 0x52, 
+	0x87, 0x57, 0x90, 0x51, 0x96, 0x8d, 0x9e, 0xc3, 
+	0x53, 0x2f, 0x56, 0xde, 0x5e, 0xfb, 0x5f, 0x8a, 
+	0x60, 0x62, 0x60, 0x94, 0x61, 0xf7, 0x66, 0x66, 
+	0x67, 0x03, 0x6a, 0x9c, 0x6d, 0xee, 0x6f, 0xae, 
+	0x70, 0x70, 0x73, 0x6a, 0x7e, 0x6a, 0x81, 0xbe, 
+	0x83, 0x34, 0x86, 0xd4, 0x8a, 0xa8, 0x8c, 0xc4, 
+	0x52, 0x83, 0x73, 0x72, 0x5b, 0x96, 0x6a, 0x6b, 
+	0x94, 0x04, 0x54, 0xee, 0x56, 0x86, 0x5b, 0x5d, 
+	0x65, 0x48, 0x65, 0x85, 0x66, 0xc9, 0x68, 0x9f, 
+	0x6d, 0x8d, 0x6d, 0xc6, 0x72, 0x3b, 0x80, 0xb4, 
+	0x91, 0x75, 0x9a, 0x4d, 0x4f, 0xaf, 0x50, 0x19, 
+	0x53, 0x9a, 0x54, 0x0e, 0x54, 0x3c, 0x55, 0x89, 
+	0x55, 0xc5, 0x5e, 0x3f, 0x5f, 0x8c, 0x67, 0x3d, 
+	0x71, 0x66, 0x73, 0xdd, 0x90, 0x05, 0x52, 0xdb, 
+	0x52, 0xf3, 0x58, 0x64, 0x58, 0xce, 0x71, 0x04, 
+	0x71, 0x8f, 0x71, 0xfb, 0x85, 0xb0, 0x8a, 0x13, 
+	0x66, 0x88, 0x85, 0xa8, 0x55, 0xa7, 0x66, 0x84, 
+	0x71, 0x4a, 0x84, 0x31, 0x53, 0x49, 0x55, 0x99, 
+	0x6b, 0xc1, 0x5f, 0x59, 0x5f, 0xbd, 0x63, 0xee, 
+	0x66, 0x89, 0x71, 0x47, 0x8a, 0xf1, 0x8f, 0x1d, 
+	0x9e, 0xbe, 0x4f, 0x11, 0x64, 0x3a, 0x70, 0xcb, 
+	0x75, 0x66, 0x86, 0x67, 0x60, 0x64, 0x8b, 0x4e, 
+	0x9d, 0xf8, 0x51, 0x47, 0x51, 0xf6, 0x53, 0x08, 
+	0x6d, 0x36, 0x80, 0xf8, 0x9e, 0xd1, 0x66, 0x15, 
+	0x6b, 0x23, 0x70, 0x98, 0x75, 0xd5, 0x54, 0x03, 
+	0x5c, 0x79, 0x7d, 0x07, 0x8a, 0x16, 0x6b, 0x20, 
+	0x6b, 0x3d, 0x6b, 0x46, 0x54, 0x38, 0x60, 0x70, 
+	0x6d, 0x3d, 0x7f, 0xd5, 0x82, 0x08, 0x50, 0xd6, 
+	0x51, 0xde, 0x55, 0x9c, 0x56, 0x6b, 0x56, 0xcd, 
+	0x59, 0xec, 0x5b, 0x09, 0x5e, 0x0c, 0x61, 0x99, 
+	0x61, 0x98, 0x62, 0x31, 0x66, 0x5e, 0x66, 0xe6, 
+	0x71, 0x99, 0x71, 0xb9, 0x71, 0xba, 0x72, 0xa7, 
+	0x79, 0xa7, 0x7a, 0x00, 0x7f, 0xb2, 0x8a, 0x70, 
+};
+
+const unsigned long long cp949_hangulMask[175] = {
+	0x1303b0113eff0793ULL, 0x0593000011102801ULL, 0x3b019703b0111e7bULL, 0x306b959300a01112ULL, 
+	0x113032011102b051ULL, 0xb879300a011102b0ULL, 0x0080001030011306ULL, 0x93000011100b0113ULL, 
+	0x0593000000102b03ULL, 0x3b011323b051746bULL, 0x7000000000001030ULL, 0x111029001303b011ULL, 
+	0xb015300000012180ULL, 0x020000303001030eULL, 0x1300000010230111ULL, 0x0113030010106b81ULL, 
+	0x0000010030111013ULL, 0x3000000022b85530ULL, 0x113afb079702b011ULL, 0x00000021011303b0ULL, 
+	0x03b011383b0d1b00ULL, 0x1300000111330113ULL, 0x00000100111c2b05ULL, 0x2a011300b0111000ULL, 
+	0x1010000102b01930ULL, 0x1030030111000000ULL, 0x0011146b07130230ULL, 0x8fb8f9742b051300ULL, 
+	0x00000000103b0113ULL, 0x01134ab0d9700000ULL, 0x000011030011103bULL, 0x100001112ab15930ULL, 
+	0x00100b0111010000ULL, 0x0000102b01130000ULL, 0x02a0111020000101ULL, 0x0102b05930210111ULL, 
+	0x011307b019300000ULL, 0x00000003b011383bULL, 0x383b0d1300000000ULL, 0x000010000103b011ULL, 
+	0x0010102001130000ULL, 0x0000011000000100ULL, 0x0002181130000000ULL, 0x0111000000100000ULL, 
+	0x0b01930000000023ULL, 0x302b011100301110ULL, 0x01303b0113c7b011ULL, 0xb011300000000280ULL, 
+	0x03b011302b011383ULL, 0x1102b011300a0011ULL, 0x0111010000002000ULL, 0x2b011302a011102bULL, 
+	0x3000000101000010ULL, 0x11302b0113029011ULL, 0xb0113000000066b0ULL, 0x07b0113a6b07d302ULL, 
+	0x1300000000200103ULL, 0x011303b011386b05ULL, 0x2b051b00000010b8ULL, 0x1000000003000110ULL, 
+	0x79700a011102a011ULL, 0x0000100a0111a2b0ULL, 0x0090111000011100ULL, 0x9300000000090111ULL, 
+	0x011322b0f9f2bb05ULL, 0x000000002001323bULL, 0x303b019306b05930ULL, 0x117000001123a011ULL, 
+	0x00001010001102b0ULL, 0x0000011003011301ULL, 0x01010010162b0793ULL, 0x0111020011300000ULL, 
+	0x00000000b0113029ULL, 0x383b05130eb05130ULL, 0x000001000303b011ULL, 0x0000103901930000ULL, 
+	0x000000003b000302ULL, 0x0000000000230113ULL, 0x0001000000100000ULL, 0x0000000290113020ULL, 
+	0x1000000000000000ULL, 0x0000030111020000ULL, 0xb079b02b01130000ULL, 0x02b011303b011323ULL, 
+	0x1343b0d9f0210111ULL, 0x011103b011303b01ULL, 0x20011322b0517020ULL, 0x300b011101901110ULL, 
+	0x0016ab019302b011ULL, 0xb011302101130100ULL, 0x02b0313029010302ULL, 0x1b42b81930000000ULL, 
+	0x0000033011383301ULL, 0x3305130000000020ULL, 0x0000000000001110ULL, 0x0130230593000001ULL, 
+	0x3011101000010100ULL, 0x0230113000000100ULL, 0x1100000010100001ULL, 0x8513020000000000ULL, 
+	0x2b01130010111003ULL, 0x303b011363b87730ULL, 0x7b30020111a2b091ULL, 0xf0d1702b011357f0ULL, 
+	0x0ab971301b0111e3ULL, 0x13029001303b0113ULL, 0x071302b011302b01ULL, 0x230113033011302bULL, 
+	0x30ab011302b01130ULL, 0x7130090111feb411ULL, 0xb011307b05d347b8ULL, 0x0000111021015303ULL, 
+	0x1102b011306b0513ULL, 0x0513000000103301ULL, 0x30000102a01038ebULL, 0x3020001302b01110ULL, 
+	0x001010000102b071ULL, 0x1011100b01130000ULL, 0x000000002b011300ULL, 0x1303b095366b0593ULL, 
+	0x0000020001103b01ULL, 0x20000103b0113000ULL, 0x3000000001000010ULL, 0x00101001030ab011ULL, 
+	0x0000000301110100ULL, 0x0300001023011302ULL, 0x0100000010000000ULL, 0x0000029000100000ULL, 
+	0x7b01538630113000ULL, 0x0021015103b01130ULL, 0x11303b0113000000ULL, 0x00011010001102b0ULL, 
+	0x020011102b011302ULL, 0x0102b01110000000ULL, 0x000102b011300100ULL, 0x2b01110000011010ULL, 
+	0x002b011302101110ULL, 0x11302b0393000000ULL, 0x0000303b011302b0ULL, 0x03b0193000000002ULL, 
+	0x0103b011102b0113ULL, 0x011302b011300000ULL, 0x0001010200001021ULL, 0x102b011300000010ULL, 
+	0x1130200001020011ULL, 0x30113001011102b0ULL, 0x02b0113000000002ULL, 0x0103b011303b0313ULL, 
+	0x0513000000002000ULL, 0x10001102b011303bULL, 0x142b011300000110ULL, 0x0110000001000001ULL, 
+	0xb011300000010280ULL, 0x0000001010000102ULL, 0x9302101110230113ULL, 0x0113003011100b05ULL, 
+	0x3b011323b051702bULL, 0x3000000000000030ULL, 0x11102b011303b011ULL, 0xb011300a01010330ULL, 
+	0x0000000020000102ULL, 0x9300a01110000011ULL, 0x0000020000102b05ULL, 0x2901110090111000ULL, 
+	0x3000000000b01110ULL, 0x11302b211302b011ULL, 0x00000020000103b0ULL, 0x02b011302b051300ULL, 
+	0x13002011103b0113ULL, 0x0013028011322b21ULL, 0x0a011102a0113028ULL, 0x3021011102921130ULL, 
+	0x11302b0113020011ULL, 0x3011122b03d30290ULL, 0x000000002b011302ULL, 
+};
+
+const unsigned short cp949_hangulRank[175] = {
+	0, 30, 42, 70, 91, 108, 128, 138, 
+	152, 165, 192, 198, 214, 226, 237, 247, 
+	262, 271, 285, 312, 323, 345, 359, 371, 
+	384, 396, 404, 422, 450, 460, 478, 490, 
+	507, 515, 524, 533, 549, 564, 579, 593, 
+	602, 609, 612, 619, 623, 634, 648, 670, 
+	679, 699, 713, 718, 736, 741, 758, 772, 
+	798, 805, 826, 841, 846, 864, 876, 884, 
+	893, 921, 931, 954, 968, 976, 985, 1002, 
+	1010, 1020, 1044, 1054, 1064, 1072, 1079, 1081, 
+	1089, 1090, 1096, 1115, 1135, 1158, 1176, 1193, 
+	1207, 1226, 1240, 1256, 1271, 1285, 1295, 1298, 
+	1311, 1319, 1327, 1332, 1339, 1353, 1380, 1401, 
+	1429, 1454, 1472, 1491, 1510, 1529, 1553, 1581, 
+	1593, 1613, 1624, 1640, 1653, 1664, 1675, 1683, 
+	1710, 1719, 1730, 1734, 1746, 1752, 1763, 1765, 
+	1769, 1789, 1804, 1817, 1826, 1839, 1847, 1857, 
+	1867, 1880, 1894, 1909, 1920, 1937, 1949, 1955, 
+	1965, 1974, 1988, 1997, 2017, 2023, 2039, 2051, 
+	2055, 2065, 2069, 2085, 2099, 2124, 2128, 2146, 
+	2161, 2164, 2175, 2183, 2194, 2202, 2221, 2228, 
+	2245, 2261, 2277, 2291, 2306, 2321, 2341, 
+};
+
+#endif
\ No newline at end of file
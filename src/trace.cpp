@@ -0,0 +1,175 @@
+#include <bmsparser/trace.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+using namespace bms;
+
+namespace
+{
+    struct event_t
+    {
+        const char *name;
+        int64_t begin;
+        int64_t end;
+        char detail[40];
+    };
+
+    /// Events kept per thread
+    const size_t CAPACITY = 1 << 16;
+
+    struct buffer_t
+    {
+        int thread;
+        std::atomic<uint64_t> head;
+        std::unique_ptr<event_t[]> events;
+    };
+
+    /// Hands the buffer of an exiting thread to the free list, events and all.
+    struct lease_t
+    {
+        buffer_t *buffer = nullptr;
+
+        ~lease_t();
+    };
+
+    // Buffers are never freed, so events of exited threads stay until writeTrace.
+    // Their number only grows to the most threads recording at once.
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<buffer_t>> buffers;
+    std::vector<buffer_t *> freeBuffers;
+}
+
+static buffer_t &thread_buffer();
+static void write_string(FILE *out, const char *text);
+
+int64_t bms::traceClock()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void bms::traceEvent(const char *name, int64_t begin, int64_t end, const char *detail)
+{
+    buffer_t &buffer = thread_buffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    event_t &event = buffer.events[head % CAPACITY];
+    event.name = name;
+    event.begin = begin;
+    event.end = end;
+    event.detail[0] = '\0';
+    if (detail)
+    {
+        size_t length = std::strlen(detail);
+        const char *tail = length < sizeof(event.detail) ? detail : detail + length - (sizeof(event.detail) - 1);
+        while ((*tail & 0xC0) == 0x80)
+        {
+            tail++;
+        }
+        std::strncpy(event.detail, tail, sizeof(event.detail) - 1);
+        event.detail[sizeof(event.detail) - 1] = '\0';
+    }
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+TraceScope::TraceScope(const char *name, const char *detail) : name(name), detail(detail), begin(traceClock()) {}
+
+TraceScope::~TraceScope()
+{
+    traceEvent(this->name, this->begin, traceClock(), this->detail);
+}
+
+bool bms::writeTrace(const std::string &file)
+{
+    FILE *out = std::fopen(file.c_str(), "w");
+    if (!out)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    std::fputs("{\"traceEvents\":[", out);
+    bool first = true;
+    for (const std::unique_ptr<buffer_t> &buffer : buffers)
+    {
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        for (uint64_t i = head > CAPACITY ? head - CAPACITY : 0; i < head; i++)
+        {
+            const event_t &event = buffer->events[i % CAPACITY];
+            std::fprintf(out, "%s\n{\"name\":", first ? "" : ",");
+            write_string(out, event.name);
+            std::fprintf(out, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", buffer->thread, event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+            if (event.detail[0])
+            {
+                std::fputs(",\"args\":{\"detail\":", out);
+                write_string(out, event.detail);
+                std::fputs("}", out);
+            }
+            std::fputs("}", out);
+            first = false;
+        }
+        buffer->head.store(0, std::memory_order_relaxed);
+    }
+    std::fputs("\n]}\n", out);
+
+    return std::fclose(out) == 0;
+}
+
+lease_t::~lease_t()
+{
+    if (this->buffer)
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        freeBuffers.push_back(this->buffer);
+    }
+}
+
+static buffer_t &thread_buffer()
+{
+    thread_local lease_t lease;
+    if (!lease.buffer)
+    {
+        // Only the first event of each thread takes the lock. A reused buffer keeps
+        // its tid and its events, which go on after those of the thread that left it.
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        if (!freeBuffers.empty())
+        {
+            lease.buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+        }
+        else
+        {
+            buffers.emplace_back(new buffer_t);
+            lease.buffer = buffers.back().get();
+            lease.buffer->thread = (int)buffers.size();
+            lease.buffer->head.store(0, std::memory_order_relaxed);
+            lease.buffer->events.reset(new event_t[CAPACITY]);
+        }
+    }
+    return *lease.buffer;
+}
+
+static void write_string(FILE *out, const char *text)
+{
+    std::fputc('"', out);
+    for (const char *c = text; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            std::fputc('\\', out);
+            std::fputc(*c, out);
+        }
+        else if ((unsigned char)*c < 0x20)
+        {
+            std::fprintf(out, "\\u%04x", *c);
+        }
+        else
+        {
+            std::fputc(*c, out);
+        }
+    }
+    std::fputc('"', out);
+}
@@ -0,0 +1,68 @@
+#include "check.hpp"
+#include <bmsparser.hpp>
+#include <bmsparser/analysis.hpp>
+#include <bmsparser/keysound.hpp>
+#include <cmath>
+
+static bms::Chart chart_with_notes(int count, float spacing)
+{
+    bms::Chart chart;
+    for (int i = 0; i < count; i++)
+    {
+        bms::Obj obj;
+        obj.type = bms::Obj::Type::NOTE;
+        obj.time = i * spacing;
+        obj.pos = obj.time;
+        obj.note.player = 1;
+        obj.note.line = 1;
+        obj.note.key = 1;
+        obj.note.end = false;
+        chart.objs.push_back(obj);
+    }
+    chart.stats.length = (count - 1) * spacing;
+    return chart;
+}
+
+/// Windows that are not positive are rejected instead of running past the notes.
+static void density_window()
+{
+    bms::Chart chart = chart_with_notes(20, 0.25f);
+
+    for (float window : {0.0f, -1.0f, NAN})
+    {
+        bms::Density density = bms::analyzeDensity(chart, window, 8);
+        CHECK(density.peak == 0);
+        CHECK(density.peakTime == 0);
+        CHECK(density.average == 0);
+        CHECK(density.curve.size() == 8);
+        CHECK(density.perSecond.empty());
+    }
+
+    bms::Density density = bms::analyzeDensity(chart, 1.0f, 8);
+    CHECK(density.peak == 4);
+    CHECK(density.curve.size() == 8);
+}
+
+/// A negative default length plays voices for no time instead of counting them below 0.
+static void polyphony_negative_default()
+{
+    bms::Chart chart = chart_with_notes(20, 0.25f);
+
+    bms::PolyphonyProfile profile = bms::profilePolyphony(chart, std::vector<float>(), -1.0f);
+    CHECK(profile.peak == 0);
+    for (const std::pair<float, int> &point : profile.curve)
+    {
+        CHECK(point.second >= 0);
+    }
+
+    profile = bms::profilePolyphony(chart, std::vector<float>(2, -1.0f), 1.0f);
+    CHECK(profile.peak == 1);
+}
+
+int main()
+{
+    density_window();
+    polyphony_negative_default();
+
+    return failures;
+}
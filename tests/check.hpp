@@ -0,0 +1,20 @@
+#ifndef __BMSPARSER_TESTS_CHECK_HPP__
+#define __BMSPARSER_TESTS_CHECK_HPP__
+
+#include <cstdio>
+
+/// Failed checks so far; main returns it, so any failure fails the test.
+static int failures = 0;
+
+/// Report a failed condition with its location and keep going.
+#define CHECK(condition)                                                            \
+    do                                                                              \
+    {                                                                               \
+        if (!(condition))                                                           \
+        {                                                                           \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                             \
+        }                                                                           \
+    } while (0)
+
+#endif
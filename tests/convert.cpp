@@ -0,0 +1,46 @@
+#include "check.hpp"
+#include <bmsparser/convert.hpp>
+#include <string>
+
+/// Every Shift_JIS code that decodes to a non-ASCII character must encode back to itself.
+static void round_trip()
+{
+    int mapped = 0;
+    auto check_code = [&](const std::string &code)
+    {
+        std::string utf8 = bms::sjis_to_utf8(code);
+        if ((unsigned char)utf8[0] < 0x80)
+        {
+            return;
+        }
+        mapped++;
+        CHECK(bms::utf8_to_sjis(utf8) == code);
+    };
+
+    for (int byte = 0x80; byte < 0x100; byte++)
+    {
+        if ((byte >= 0x80 && byte < 0xA0) || byte >= 0xE0)
+        {
+            continue;
+        }
+        check_code(std::string(1, (char)byte));
+    }
+    for (int lead : {0x80, 0x90, 0xE0})
+    {
+        for (int code = 0; code < 0x1000; code++)
+        {
+            check_code(std::string{(char)(lead | (code >> 8)), (char)(code & 0xff)});
+        }
+    }
+    CHECK(mapped > 6900);
+}
+
+int main()
+{
+    round_trip();
+
+    CHECK(bms::utf8_to_sjis("\xe8\xad\x9c\xe9\x9d\xa2 test") == "\x95\x88\x96\xca test");
+    CHECK(bms::utf8_to_sjis("\xf0\x9f\x8e\xb5") == "?");
+
+    return failures;
+}
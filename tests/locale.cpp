@@ -0,0 +1,99 @@
+#include "check.hpp"
+#include <bmsparser.hpp>
+#include <clocale>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+/// Exit code CTest reports as a skip, when no comma-decimal locale is installed.
+static const int SKIPPED = 77;
+
+static const char *const chart = "#PLAYER 1\n"
+                                 "#TITLE Locale\n"
+                                 "#BPM 150.5\n"
+                                 "#TOTAL 212.75\n"
+                                 "#BPM01 187.25\n"
+                                 "#STOP01 48\n"
+                                 "#00102:0.75\n"
+                                 "#00108:01\n"
+                                 "#00109:0001\n"
+                                 "#00111:01010101\n"
+                                 "#00202:1.125\n"
+                                 "#00212:0101\n"
+                                 "#00302:0.3\n"
+                                 "#00313:01\n";
+
+static bool set_comma_locale();
+static void compare(const bms::Chart &c, const bms::Chart &comma);
+
+/// Header and signature floats parse the same whatever the C locale says the decimal point is.
+int main()
+{
+    std::string file = (std::filesystem::temp_directory_path() / "bmsparser_test_locale.bms").string();
+    {
+        std::ofstream output(file, std::ios::binary);
+        output << chart;
+    }
+
+    std::setlocale(LC_NUMERIC, "C");
+    std::unique_ptr<bms::Chart> c(bms::parseBMS(file));
+
+    if (!set_comma_locale())
+    {
+        std::fprintf(stderr, "no comma-decimal locale installed, skipped\n");
+        std::filesystem::remove(file);
+        return SKIPPED;
+    }
+    std::unique_ptr<bms::Chart> comma(bms::parseBMS(file));
+    std::setlocale(LC_NUMERIC, "C");
+    std::filesystem::remove(file);
+
+    CHECK(c->total == 212.75f);
+    CHECK(!c->sectors.empty() && c->sectors[0].bpm == 150.5f);
+    compare(*c, *comma);
+
+    return failures;
+}
+
+/**
+ * Switch LC_NUMERIC to a locale whose decimal point is a comma.
+ * BMSPARSER_TEST_LOCALE names one to try before the usual ones.
+ * \return Whether one was found
+ */
+static bool set_comma_locale()
+{
+    const char *names[] = {std::getenv("BMSPARSER_TEST_LOCALE"), "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR", "ru_RU.UTF-8", "ru_RU.utf8"};
+    for (const char *name : names)
+    {
+        if (name && std::setlocale(LC_NUMERIC, name) && std::localeconv()->decimal_point[0] == ',')
+        {
+            return true;
+        }
+    }
+    std::setlocale(LC_NUMERIC, "C");
+    return false;
+}
+
+static void compare(const bms::Chart &c, const bms::Chart &comma)
+{
+    CHECK(c.total == comma.total);
+    CHECK(c.measureStarts == comma.measureStarts);
+    CHECK(c.signatures == comma.signatures);
+    CHECK(c.sectors.size() == comma.sectors.size());
+    for (size_t i = 0; i < c.sectors.size() && i < comma.sectors.size(); i++)
+    {
+        CHECK(c.sectors[i].pos == comma.sectors[i].pos);
+        CHECK(c.sectors[i].time == comma.sectors[i].time);
+        CHECK(c.sectors[i].bpm == comma.sectors[i].bpm);
+        CHECK(c.sectors[i].inclusive == comma.sectors[i].inclusive);
+    }
+    CHECK(c.objs.size() == comma.objs.size());
+    for (size_t i = 0; i < c.objs.size() && i < comma.objs.size(); i++)
+    {
+        CHECK(c.objs[i].type == comma.objs[i].type);
+        CHECK(c.objs[i].pos == comma.objs[i].pos);
+        CHECK(c.objs[i].time == comma.objs[i].time);
+    }
+}
@@ -0,0 +1,52 @@
+#include "check.hpp"
+#include <bmsparser.hpp>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+static std::string write_chart(const std::string &name, const std::string &text);
+
+/// Block directives are header lines, whether the branch they open is taken or not.
+static void stats_lines()
+{
+    std::string file = write_chart("stats", "#RANDOM 3\n"
+                                            "#IF 1\n"
+                                            "#TITLE A\n"
+                                            "#ELSE\n"
+                                            "#TITLE B\n"
+                                            "#ENDIF\n"
+                                            "#IF 2\n"
+                                            "#00111:01\n"
+                                            "#ENDIF\n"
+                                            "#IF 3\n"
+                                            "#00111:01\n"
+                                            "#ENDIF\n"
+                                            "#BPM 120\n"
+                                            "#00112:01\n");
+
+    bms::ParseStats stats;
+    std::unique_ptr<bms::Chart> chart(bms::parseBMS(file, std::vector<int>{1}, &stats));
+    std::filesystem::remove(file);
+
+    CHECK(chart->title == "A");
+    CHECK(stats.lines == 14);
+    CHECK(stats.headerLines == 10);
+    CHECK(stats.channelLines == 1);
+    CHECK(stats.skippedLines == 3);
+}
+
+int main()
+{
+    stats_lines();
+
+    return failures;
+}
+
+static std::string write_chart(const std::string &name, const std::string &text)
+{
+    std::string file = (std::filesystem::temp_directory_path() / ("bmsparser_test_" + name + ".bms")).string();
+    std::ofstream output(file, std::ios::binary);
+    output << text;
+    return file;
+}
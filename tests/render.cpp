@@ -0,0 +1,88 @@
+#include "check.hpp"
+#include <bmsparser.hpp>
+#include <bmsparser/render.hpp>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+static const char *const chart = "#PLAYER 1\n"
+                                 "#BPM 120\n"
+                                 "#BPM01 240\n"
+                                 "#BPM02 90\n"
+                                 "#STOP01 96\n"
+                                 "#00108:0102\n"
+                                 "#00109:00010000\n"
+                                 "#00208:02010201\n"
+                                 "#00209:01000001\n"
+                                 "#00111:0101010101010101\n"
+                                 "#00212:01010101\n"
+                                 "#00313:0101\n"
+                                 "#00408:01\n"
+                                 "#00411:01\n";
+
+static std::vector<bms::NoteInstance> expected(const bms::Chart &chart, const bms::LaneIndex &index, float time, float hiSpeed);
+
+/// Frames moving forward and back through speed changes and stops match Chart::time2pos.
+static void cursor_sectors()
+{
+    std::string file = (std::filesystem::temp_directory_path() / "bmsparser_test_render.bms").string();
+    {
+        std::ofstream output(file, std::ios::binary);
+        output << chart;
+    }
+    std::unique_ptr<bms::Chart> parsed(bms::parseBMS(file));
+    std::filesystem::remove(file);
+    CHECK(parsed->sectors.size() > 5);
+
+    bms::LaneIndex index(*parsed);
+    bms::RenderCursor cursor(*parsed, index, 1u << (int)bms::Obj::Type::NOTE);
+    const float hiSpeed = 2;
+    bms::NoteInstance buffer[64];
+    std::vector<float> times;
+    for (int i = -4; i <= 120; i++)
+    {
+        times.push_back(i * 0.0625f);
+    }
+    for (const bms::Sector &sector : parsed->sectors)
+    {
+        times.push_back(sector.time);
+    }
+    times.push_back(1.0f);
+    times.push_back(0.25f);
+
+    for (float time : times)
+    {
+        size_t count = cursor.fill(time, hiSpeed, buffer, 64);
+        std::vector<bms::NoteInstance> instances = expected(*parsed, index, time, hiSpeed);
+        CHECK(count == instances.size());
+        for (size_t i = 0; i < count && i < instances.size(); i++)
+        {
+            CHECK(buffer[i].lane == instances[i].lane);
+            CHECK(buffer[i].y == instances[i].y);
+        }
+    }
+}
+
+int main()
+{
+    cursor_sectors();
+
+    return failures;
+}
+
+static std::vector<bms::NoteInstance> expected(const bms::Chart &chart, const bms::LaneIndex &index, float time, float hiSpeed)
+{
+    float posBegin = chart.time2pos(time);
+    bms::VisibleRange range = index.visibleRange(posBegin, posBegin + 1 / hiSpeed, 1u << (int)bms::Obj::Type::NOTE);
+    std::vector<bms::NoteInstance> instances;
+    for (int lane = 0; lane < bms::LANES; lane++)
+    {
+        for (const bms::LaneObj *obj = range.notes[lane].begin; obj != range.notes[lane].end; obj++)
+        {
+            instances.push_back(bms::NoteInstance{(obj->pos - posBegin) * hiSpeed, (obj->end - obj->pos) * hiSpeed, (uint16_t)lane, (uint16_t)bms::Obj::Type::NOTE});
+        }
+    }
+    return instances;
+}